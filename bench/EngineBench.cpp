@@ -0,0 +1,541 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+/*
+* Headless benchmark of full GameStateManager frames.
+*
+* Boots Application on SDL's dummy video driver and software renderer, pushes synthetic states (sprites, text labels, a
+* scrolling map and event subscribers) and runs a fixed number of frames as fast as possible. Reports frame time percentiles for the whole
+* frame and for poll/update/render, heap allocations per frame and the peak resident set size.
+*
+* Like the game, it has to be run from the directory holding the assets folder.
+*
+* Usage: enginebench [--frames N] [--warmup N] [--sprites N] [--labels N] [--map N] [--subscribers N] [--pipelined]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "Application.h"
+#include "engine/States.h"
+#include "engine/Updateables.h"
+#include "engine/Renderables.h"
+#include "engine/IOStates.h"
+#include "engine/GameStateManager.h"
+#include "engine/WindowManager.h"
+#include "engine/Texture.h"
+#include "engine/Writer.h"
+#include "engine/EventManager.h"
+#include "engine/EventJournal.h"
+#include "engine/Profiler.h"
+#include "engine/SpatialGrid.h"
+
+
+// -----------------------------------------------------------------------------
+// Allocation counting. Every heap allocation in the process goes through these.
+
+static std::atomic<unsigned long long> gAllocations(0);
+
+void* operator new(std::size_t size){
+    gAllocations++;
+    void* p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept{
+    std::free(p);
+}
+
+
+// -----------------------------------------------------------------------------
+
+struct sBenchConfig{
+    int frames;
+    int warmup;
+    int sprites;
+    int labels;
+    int mapObjects;
+    int subscribers;
+    bool pipelined;
+
+    sBenchConfig() : frames(600), warmup(10), sprites(1000), labels(50), mapObjects(0), subscribers(100), pipelined(false){}
+};
+
+struct sFrameSample{
+    double frame;
+    double poll;
+    double update;
+    double render;
+    unsigned long long allocations;
+};
+
+
+/** Moves a field of sprites around, all sharing one texture and drawn through the window's sprite batch. */
+class SpriteField : public engine::IState, public engine::IUpdateable, public engine::IRenderable
+{
+    public:
+        SpriteField(int count) : mCount(count){
+            registerCapabilities(this);
+        }
+
+        void start(){
+            mWindow = engine::WindowManager::getInstance()->get(MAINWINDOW_RESOURCE_NAME);
+            mWindow->getLogicalRendererSize(&mWidth, &mHeight);
+            mTexture = engine::TexturePtr(new engine::Texture(mWindow, SPRITE_SIZE, SPRITE_SIZE));
+
+            mSprites.resize(mCount);
+            for (size_t i = 0; i < mSprites.size(); i++){
+                mSprites[i].x = static_cast<float>((i*37) % (mWidth - SPRITE_SIZE));
+                mSprites[i].y = static_cast<float>((i*53) % (mHeight - SPRITE_SIZE));
+                mSprites[i].dx = static_cast<float>(static_cast<int>(i % 7) - 3);
+                mSprites[i].dy = static_cast<float>(static_cast<int>(i % 5) - 2);
+                mSprites[i].angle = static_cast<double>(i % 360);
+            }
+        }
+        void stop(){
+            mTexture.reset();
+        }
+        void getFocus(){}
+        void looseFocus(){}
+
+        bool parallelUpdate(){return true;}
+
+        void update(){
+            for (size_t i = 0; i < mSprites.size(); i++){
+                sSprite &s = mSprites[i];
+                s.x += s.dx;
+                s.y += s.dy;
+                if (s.x < 0 || s.x > mWidth - SPRITE_SIZE){
+                    s.dx = -s.dx;
+                }
+                if (s.y < 0 || s.y > mHeight - SPRITE_SIZE){
+                    s.dy = -s.dy;
+                }
+                s.angle += 1.0;
+            }
+        }
+
+        void render(){
+            SDL_Rect dst = {0, 0, SPRITE_SIZE, SPRITE_SIZE};
+            for (size_t i = 0; i < mSprites.size(); i++){
+                dst.x = static_cast<int>(mSprites[i].x);
+                dst.y = static_cast<int>(mSprites[i].y);
+                mTexture->batch(nullptr, &dst, mSprites[i].angle);
+            }
+        }
+
+    private:
+        static const int SPRITE_SIZE = 32;
+
+        struct sSprite{
+            float x, y, dx, dy;
+            double angle;
+        };
+
+        int mCount;
+        int mWidth;
+        int mHeight;
+        engine::WindowHnd mWindow;
+        engine::TexturePtr mTexture;
+        std::vector<sSprite> mSprites;
+};
+
+
+/** Draws a column of text labels through the Writer every frame. */
+class LabelField : public engine::IState, public engine::IRenderable
+{
+    public:
+        LabelField(int count) : mCount(count){
+            registerCapabilities(this);
+        }
+
+        void start(){
+            mWindow = engine::WindowManager::getInstance()->get(MAINWINDOW_RESOURCE_NAME);
+            mWriter = engine::Writer::getHandle();
+            for (int i = 0; i < mCount; i++){
+                mLabels.push_back(std::string("Benchmark label #") + std::to_string(i));
+            }
+        }
+        void stop(){}
+        void getFocus(){}
+        void looseFocus(){}
+
+        void render(){
+            int lineHeight = mWriter->getFontPixelHeight(FONT_NAME);
+            for (size_t i = 0; i < mLabels.size(); i++){
+                mWriter->presentToWindow(mWindow, FONT_NAME, mLabels[i], 10 + static_cast<int>(i/40)*300, 10 + static_cast<int>(i%40)*lineHeight);
+            }
+        }
+
+    private:
+        static const char* FONT_NAME;
+
+        int mCount;
+        engine::WindowHnd mWindow;
+        engine::WriterHnd mWriter;
+        std::vector<std::string> mLabels;
+};
+const char* LabelField::FONT_NAME = "default12";
+
+
+/**
+* Pans the camera across a map many screens in size, covered in objects kept in a SpatialGrid, drawing only those the
+* viewport shows. Its cost should follow what's on screen, not the object count.
+*/
+class MapField : public engine::IState, public engine::IRenderable
+{
+    public:
+        MapField(int count) : mCount(count), mFrame(0){
+            registerCapabilities(this);
+        }
+
+        void start(){
+            mWindow = engine::WindowManager::getInstance()->get(MAINWINDOW_RESOURCE_NAME);
+            mWindow->getLogicalRendererSize(&mWidth, &mHeight);
+            mTexture = engine::TexturePtr(new engine::Texture(mWindow, OBJECT_SIZE, OBJECT_SIZE));
+
+            mMapWidth = mWidth*MAP_SCREENS;
+            mMapHeight = mHeight*MAP_SCREENS;
+            for (int i = 0; i < mCount; i++){
+                SDL_Rect bounds = {
+                    static_cast<int>((static_cast<long long>(i)*7919) % (mMapWidth - OBJECT_SIZE)),
+                    static_cast<int>((static_cast<long long>(i)*104729) % (mMapHeight - OBJECT_SIZE)),
+                    OBJECT_SIZE, OBJECT_SIZE
+                };
+                mGrid.insert(bounds, bounds);
+            }
+        }
+        void stop(){
+            mWindow->setCamera(0, 0);
+        }
+        void getFocus(){}
+        void looseFocus(){}
+
+        void render(){
+            // The camera moves here rather than in an update, as updates may run on another thread.
+            mFrame++;
+            mWindow->setCamera((mFrame*4) % (mMapWidth - mWidth), (mFrame*3) % (mMapHeight - mHeight));
+
+            SDL_Rect view;
+            mWindow->getViewport(&view);
+            mVisible.clear();
+            mGrid.query(view, mVisible);
+
+            SDL_Rect dst;
+            for (size_t i = 0; i < mVisible.size(); i++){
+                mWindow->worldToScreen(mVisible[i], dst);
+                mTexture->batch(nullptr, &dst);
+            }
+        }
+
+    private:
+        static const int OBJECT_SIZE = 16;
+        static const int MAP_SCREENS = 16;
+
+        int mCount;
+        int mFrame;
+        int mWidth;
+        int mHeight;
+        int mMapWidth;
+        int mMapHeight;
+        engine::WindowHnd mWindow;
+        engine::TexturePtr mTexture;
+        engine::SpatialGrid<SDL_Rect> mGrid;
+        std::vector<SDL_Rect> mVisible;
+};
+
+
+/** Subscribes a number of handlers to an event, then queues and flushes that event on every update. */
+class EventSubscribers : public engine::IState, public engine::IUpdateable
+{
+    public:
+        EventSubscribers(int count) : mCount(count), mDelivered(0){
+            registerCapabilities(this);
+        }
+
+        void start(){
+            mEventManager = engine::EventManager::getInstance();
+            for (int i = 0; i < mCount; i++){
+                mConnections.push_back(mEventManager->Subscribe(EVENT_NAME, boost::bind(&EventSubscribers::onTick, this, _1)));
+            }
+        }
+        void stop(){
+            for (size_t i = 0; i < mConnections.size(); i++){
+                mConnections[i].disconnect();
+            }
+            mConnections.clear();
+        }
+        void getFocus(){}
+        void looseFocus(){}
+
+        void update(){
+            engine::EventDict dict;
+            dict["tick"] = mDelivered;
+            mEventManager->QueueEvent(EVENT_NAME, dict);
+            mEventManager->FlushQueue();
+        }
+
+    private:
+        static const char* EVENT_NAME;
+
+        int mCount;
+        unsigned int mDelivered;
+        engine::EventManagerPtr mEventManager;
+        std::vector<boost::signals2::connection> mConnections;
+
+        void onTick(const engine::EventDict){
+            mDelivered++;
+        }
+};
+const char* EventSubscribers::EVENT_NAME = "bench_tick";
+
+
+/**
+* Samples the profiler once per frame and ends the run after the requested number of frames.
+* Render order puts it last, so each sample is taken after everything else has drawn; the profiler totals it reads are
+* those of the frame before.
+*/
+class BenchRecorder : public engine::IState, public engine::IRenderable, public engine::IIOState
+{
+    public:
+        BenchRecorder(engine::GameStateManagerHnd gsm, int frames, int warmup) : mGameStateManager(gsm), mFrames(frames), mWarmup(warmup), mRenders(0), mLastAllocations(0), mDone(false){
+            registerCapabilities(this);
+            mSamples.reserve(frames);
+            mFrameTimes.reserve(engine::Profiler::HISTORY_SIZE);
+            mZoneStats.reserve(64);
+        }
+
+        void start(){
+            mProfiler = engine::Profiler::getInstance();
+            mLastAllocations = gAllocations;
+        }
+        void stop(){}
+        void getFocus(){}
+        void looseFocus(){}
+        bool isOverlay(){return true;}
+
+        void render(){
+            unsigned long long allocations = gAllocations;
+            if (mRenders > mWarmup && static_cast<int>(mSamples.size()) < mFrames){
+                sFrameSample sample;
+                std::memset(&sample, 0, sizeof(sFrameSample));
+                mProfiler->getFrameTimes(mFrameTimes);
+                if (!mFrameTimes.empty()){
+                    sample.frame = mFrameTimes.back();
+                }
+                mProfiler->getZoneStats(mZoneStats);
+                for (size_t i = 0; i < mZoneStats.size(); i++){
+                    if (std::strcmp(mZoneStats[i].name, "GameStateManager::poll") == 0){
+                        sample.poll = mZoneStats[i].ms;
+                    } else if (std::strcmp(mZoneStats[i].name, "GameStateManager::update") == 0){
+                        sample.update += mZoneStats[i].ms;
+                    } else if (std::strcmp(mZoneStats[i].name, "GameStateManager::render") == 0){
+                        sample.render = mZoneStats[i].ms;
+                    }
+                }
+                sample.allocations = allocations - mLastAllocations;
+                mSamples.push_back(sample);
+            }
+            mRenders++;
+            mLastAllocations = allocations;
+
+            if (!mDone && static_cast<int>(mSamples.size()) >= mFrames){
+                // States can't be dropped mid-render, so the run is ended from poll on the next frame.
+                mDone = true;
+                SDL_Event event;
+                std::memset(&event, 0, sizeof(SDL_Event));
+                event.type = SDL_USEREVENT;
+                SDL_PushEvent(&event);
+            }
+        }
+
+        bool poll(SDL_Event event){
+            if (mDone && event.type == SDL_USEREVENT){
+                mGameStateManager->clear();
+                return true;
+            }
+            return false;
+        }
+
+        const std::vector<sFrameSample>& samples(){
+            return mSamples;
+        }
+
+    private:
+        engine::GameStateManagerHnd mGameStateManager;
+        engine::ProfilerPtr mProfiler;
+        int mFrames;
+        int mWarmup;
+        int mRenders;
+        unsigned long long mLastAllocations;
+        bool mDone;
+
+        std::vector<sFrameSample> mSamples;
+        std::vector<double> mFrameTimes;
+        engine::Profiler::ZoneStatsList mZoneStats;
+};
+
+
+// -----------------------------------------------------------------------------
+
+class BenchApplication : public Application
+{
+    public:
+        engine::GameStateManagerPtr getGameStateManagerPtr(){
+            return mGameStateManager;
+        }
+};
+
+static double Percentile(std::vector<double> values, double p){
+    if (values.empty()){
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p*(values.size()-1) + 0.5);
+    return values[std::min(rank, values.size()-1)];
+}
+
+static void PrintTimes(const char* name, const std::vector<double> &values){
+    printf("%-8s p50 %8.3fms  p90 %8.3fms  p99 %8.3fms  max %8.3fms\n", name, Percentile(values, 0.5), Percentile(values, 0.9), Percentile(values, 0.99), Percentile(values, 1.0));
+}
+
+static long PeakRSSKB(){
+#if defined(__APPLE__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss/1024; // Bytes on macOS.
+#elif defined(__unix__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#else
+    return -1;
+#endif
+}
+
+static bool ReadIntArg(int argc, char** argv, int &i, const char* name, int &value){
+    if (std::strcmp(argv[i], name) == 0 && i+1 < argc){
+        value = std::atoi(argv[++i]);
+        return true;
+    }
+    return false;
+}
+
+
+int main(int argc, char** argv)
+{
+    sBenchConfig config;
+    for (int i = 1; i < argc; i++){
+        if (ReadIntArg(argc, argv, i, "--frames", config.frames) ||
+            ReadIntArg(argc, argv, i, "--warmup", config.warmup) ||
+            ReadIntArg(argc, argv, i, "--sprites", config.sprites) ||
+            ReadIntArg(argc, argv, i, "--labels", config.labels) ||
+            ReadIntArg(argc, argv, i, "--map", config.mapObjects) ||
+            ReadIntArg(argc, argv, i, "--subscribers", config.subscribers)){
+            continue;
+        }
+        if (std::strcmp(argv[i], "--pipelined") == 0){
+            config.pipelined = true;
+        } else {
+            printf("Usage: %s [--frames N] [--warmup N] [--sprites N] [--labels N] [--map N] [--subscribers N] [--pipelined]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (config.frames <= 0){
+        config.frames = 1;
+    }
+
+    engine::EventJournal::UseHeadlessVideo();
+
+    BenchApplication *app = nullptr;
+    try{
+        app = new BenchApplication();
+    } catch (std::runtime_error e){
+        printf("Failed to start: %s\n", e.what());
+        return 1;
+    }
+    // Run unpaced and never sleep, so frame times are the engine's own cost.
+    app->setFrameRateLimit(0);
+    app->setIdleMode(false);
+    // One update per frame, so update times compare between runs rather than following the wall clock.
+    app->setFixedStepsPerFrame(1);
+    app->setPipelined(config.pipelined);
+
+    engine::GameStateManagerPtr gsm = app->getGameStateManagerPtr();
+    std::shared_ptr<BenchRecorder> recorder(new BenchRecorder(app->getGameStateManager(), config.frames, config.warmup));
+    gsm->addState(engine::StatePtr(new EventSubscribers(config.subscribers)));
+    if (config.mapObjects > 0){
+        gsm->addState(engine::StatePtr(new MapField(config.mapObjects)));
+    }
+    gsm->addState(engine::StatePtr(new SpriteField(config.sprites)));
+    gsm->addState(engine::StatePtr(new LabelField(config.labels)));
+    gsm->addState(recorder);
+
+    app->run();
+
+    const std::vector<sFrameSample> &samples = recorder->samples();
+    std::vector<double> frame, poll, update, render, allocations;
+    for (size_t i = 0; i < samples.size(); i++){
+        frame.push_back(samples[i].frame);
+        poll.push_back(samples[i].poll);
+        update.push_back(samples[i].update);
+        render.push_back(samples[i].render);
+        allocations.push_back(static_cast<double>(samples[i].allocations));
+    }
+
+    printf("%d frames (%d warmup), %d sprites, %d labels, %d map objects, %d subscribers%s\n", static_cast<int>(samples.size()), config.warmup, config.sprites, config.labels, config.mapObjects, config.subscribers, config.pipelined ? ", pipelined" : "");
+    PrintTimes("frame", frame);
+    PrintTimes("poll", poll);
+    PrintTimes("update", update);
+    PrintTimes("render", render);
+    printf("%-8s p50 %8.0f    p90 %8.0f    p99 %8.0f    max %8.0f\n", "allocs", Percentile(allocations, 0.5), Percentile(allocations, 0.9), Percentile(allocations, 0.99), Percentile(allocations, 1.0));
+    printf("peak RSS %ldKB\n", PeakRSSKB());
+
+    delete app;
+    return 0;
+}
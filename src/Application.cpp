@@ -23,9 +23,11 @@
 */
 
 #include "Application.h"
+#include "engine/TextureManager.h"
+#include "engine/VirtualFileSystem.h"
 
 
-Application::Application(){
+Application::Application() : mUpdateStepTime(DEFAULT_UPDATE_STEP_TIME), mMaxCatchUpSteps(5), mFrameRateLimit(DEFAULT_FRAME_RATE_LIMIT), mVSync(false), mPipelined(false), mIdleMode(true), mFixedStepsPerFrame(0){
     // While we create the GameStateManager in the Application class, only decendants can access and push a state to it.
     mGameStateManager = engine::GameStateManagerPtr(new engine::GameStateManager());
     engine::WindowManager* wm = engine::WindowManager::getInstance();
@@ -41,6 +43,16 @@ Application::Application(){
         throw std::runtime_error("Failed to create main application window.");
     }
     w->setLogicalRendererSize(1680, 1050);
+    mWindow = w;
+
+    SDL_RendererInfo rinfo;
+    w->getRenderInfo(rinfo);
+    mVSync = (rinfo.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+
+    engine::VirtualFileSystemPtr vfs = engine::VirtualFileSystem::getInstance();
+    if (vfs->exists(ASSET_ARCHIVE_PATH)){
+        vfs->mount(ASSET_ARCHIVE_PATH);
+    }
 
     engine::WriterHnd writer = engine::Writer::getHandle();
     if (writer.get() != 0){
@@ -57,13 +69,110 @@ Application::~Application()
 }
 
 void Application::run(){
+    engine::EventJournalPtr journal = engine::EventJournal::getInstance();
+    engine::ProfilerPtr profiler = engine::Profiler::getInstance();
+    mUpdateTimer.restart(mUpdateStepTime);
     while (not mGameStateManager->empty()){
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+
+        // Input may change state the simulation thread is working on, so its update has to be done before polling.
+        mGameStateManager->finishUpdate();
+
+        // Never sleep while images are still on their way in; they'd wait for the next input to show.
+        engine::TextureManager* textures = engine::TextureManager::getInstance();
+        bool idling = mIdleMode && !journal->replaying();
+        // Taken before the updates, as once they've run, a state's next deadline is always in the future; the frame is
+        // drawn if this one has come.
+        unsigned int idleUntil = mGameStateManager->idleUntil();
+        bool waited = idling && textures->pendingLoads() == 0 && mGameStateManager->waitForActivity();
+
         mGameStateManager->poll();
-        mGameStateManager->update();
-        mGameStateManager->render();
+        // A replay is over once every journaled frame has been delivered.
+        if (journal->finished()){
+            mGameStateManager->clear();
+            break;
+        }
+
+        int steps = 0;
+        if (journal->replaying()){
+            // Replays run unpaced, so the number of updates comes from the journal rather than the clock.
+            steps = journal->replayUpdateSteps();
+        } else if (mFixedStepsPerFrame > 0){
+            steps = mFixedStepsPerFrame;
+            journal->recordUpdateSteps(steps);
+        } else {
+            // Time spent asleep had nothing to simulate, so it isn't caught up on.
+            steps = mUpdateTimer.steps(waited ? 1 : mMaxCatchUpSteps);
+            journal->recordUpdateSteps(steps);
+        }
+        float alpha = (journal->replaying() || mFixedStepsPerFrame > 0) ? 1.0f : mUpdateTimer.stepAlpha();
+        if (mPipelined && mGameStateManager->pipelineReady()){
+            // Render what the last update produced while the next one runs on the simulation thread.
+            mGameStateManager->snapshot();
+            mGameStateManager->beginUpdate(steps);
+        } else {
+            for (int i = 0; i < steps; i++){
+                mGameStateManager->update();
+            }
+        }
+
+        // Images decoded on the job pool are uploaded here, on the render thread, a frame's budget at a time.
+        bool uploaded = textures->uploadPending() > 0;
+
+        // While idling, a frame is only drawn if something changed or a state said it would have by now.
+        bool skipRender = idling && !uploaded && !mGameStateManager->changed() && idleUntil != 0 && SDL_GetTicks() < idleUntil;
+
+        // The window is cleared and presented here, rather than by the states, so every state on the stack (overlays
+        // included) draws into the same frame.
+        if (!skipRender){
+            if (mWindow.IsValid()){
+                mWindow->clear();
+            }
+            mGameStateManager->renderInterpolated(alpha);
+            if (mWindow.IsValid()){
+                mWindow->present();
+            }
+        }
+
+        // Once presented, nothing still waits to be drawn from a texture, so this is where they can be released to fit
+        // the memory budget. They prepare again the next time they are drawn.
+        textures->enforceBudget();
+        engine::Resource::AdvanceUseClock();
+
+        if (!journal->replaying()){
+            LimitFrameRate(frameStart);
+        }
+        profiler->endFrame();
+    }
+    mGameStateManager->finishUpdate();
+}
+
+void Application::setUpdateRate(int stepTime, int maxCatchUpSteps){
+    if (stepTime > 0){
+        mUpdateStepTime = stepTime;
+        mMaxCatchUpSteps = maxCatchUpSteps;
+        if (mUpdateTimer.started()){
+            mUpdateTimer.restart(mUpdateStepTime);
+        }
     }
 }
 
+void Application::setFrameRateLimit(int fps){
+    mFrameRateLimit = fps > 0 ? fps : 0;
+}
+
+void Application::setPipelined(bool enable){
+    mPipelined = enable;
+}
+
+void Application::setIdleMode(bool enable){
+    mIdleMode = enable;
+}
+
+void Application::setFixedStepsPerFrame(int steps){
+    mFixedStepsPerFrame = steps > 0 ? steps : 0;
+}
+
 engine::GameStateManagerHnd Application::getGameStateManager(){
     if (mGameStateManager.get() != 0){
         return engine::GameStateManagerHnd(mGameStateManager);
@@ -72,4 +181,18 @@ engine::GameStateManagerHnd Application::getGameStateManager(){
 }
 
 
-
+// PRIVATE
+void Application::LimitFrameRate(Uint64 frameStart){
+    if (mFrameRateLimit > 0 && !mVSync){
+        Uint64 freq = SDL_GetPerformanceFrequency();
+        Uint64 frameTime = freq/mFrameRateLimit;
+        Uint64 elapsed = SDL_GetPerformanceCounter() - frameStart;
+        if (elapsed < frameTime){
+            // SDL_Delay only has millisecond resolution, so round down and let the next frame absorb the difference.
+            Uint32 ms = static_cast<Uint32>(((frameTime - elapsed)*1000)/freq);
+            if (ms > 0){
+                SDL_Delay(ms);
+            }
+        }
+    }
+}
@@ -37,6 +37,9 @@
 #include "engine/Window.h"
 #include "engine/GameStateManager.h"
 #include "engine/Writer.h"
+#include "engine/EventJournal.h"
+#include "engine/Timer.h"
+#include "engine/Profiler.h"
 
 
 class Application
@@ -47,9 +50,50 @@ class Application
         void run();
         engine::GameStateManagerHnd getGameStateManager();
 
+        /**
+        * Sets the fixed timestep, in milliseconds, the game states are updated at, and the maximum number of updates run in
+        * a single frame to catch up after a stall.
+        */
+        void setUpdateRate(int stepTime, int maxCatchUpSteps=5);
+
+        /**
+        * Caps the number of frames rendered per second. A limit of 0 (zero) renders as fast as possible.
+        * The limit is ignored when the main window presents with vsync, as presenting already paces the loop.
+        */
+        void setFrameRateLimit(int fps);
+
+        /**
+        * Enables running the updates for the next frame on the simulation thread while the current frame renders. Only takes
+        * effect on frames where every updateable state implements IRenderSnapshot; all other frames run sequentially.
+        */
+        void setPipelined(bool enable);
+
+        /**
+        * Enables sleeping while no state has anything to show (see IState::idleUntil), and skipping render and present for
+        * frames where nothing changed. Enabled by default. Never applies while replaying an event journal.
+        */
+        void setIdleMode(bool enable);
+
+        /**
+        * Runs exactly the given number of updates every frame, whatever the time, with no interpolation between them.
+        * Makes unpaced runs (benchmarks) do the same work every frame. 0 (zero), the default, goes back to the clock.
+        */
+        void setFixedStepsPerFrame(int steps);
+
     protected:
         engine::GameStateManagerPtr mGameStateManager;
     private:
+        engine::WindowHnd mWindow;
+        Timer mUpdateTimer;
+        int mUpdateStepTime;
+        int mMaxCatchUpSteps;
+        int mFrameRateLimit;
+        bool mVSync;
+        bool mPipelined;
+        bool mIdleMode;
+        int mFixedStepsPerFrame;
+
+        void LimitFrameRate(Uint64 frameStart);
 };
 
 #endif // APPLICATION_H
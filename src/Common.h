@@ -30,4 +30,11 @@
 const std::string MAINWINDOW_RESOURCE_NAME = "MainWindow";
 const std::string MAINWINDOW_RESOURCE_TITLE = "Space Frontiers";
 
+// Mounted at startup when present. Assets packed into it take precedence over loose files.
+const std::string ASSET_ARCHIVE_PATH = "assets.sfpk";
+
+// Milliseconds per fixed timestep update, and the default cap on rendered frames per second.
+const int DEFAULT_UPDATE_STEP_TIME = 16;
+const int DEFAULT_FRAME_RATE_LIMIT = 60;
+
 #endif // COMMON_H
@@ -24,7 +24,12 @@
 
 #include "MainMenu.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
+
 const std::string MainMenu::TEXTURE_BACKGROUND_NAME = "tBackground";
+const std::string MainMenu::LAYER_MENU_ITEMS_NAME = "MainMenu.items";
+const std::string MainMenu::LAYER_CODE_STREAM_NAME = "MainMenu.codeStream";
 
 /*
 * NOTE: Defined below is a estetically modified and comment stripped form of a C++ Sha1 class source code.
@@ -182,7 +187,9 @@ const std::string MainMenu::CODE_STREAM_TEXT = "#ifndef SHA1_HEADER\n"
 
 
 MainMenu::MainMenu(engine::GameStateManagerHnd gsm){
+    registerCapabilities(this);
     mHasFocus = false;
+    mPrepared = false;
     mMenuItemID = 0;
     mLogicalRenderWidth = 0;
     mLogicalRenderHeight = 0;
@@ -194,6 +201,10 @@ MainMenu::MainMenu(engine::GameStateManagerHnd gsm){
     mMenuItems[0].itemName = "Start Game";
     mMenuItems[1].itemName = "Options";
     mMenuItems[2].itemName = "Quit";
+    for (int i = 0; i < mMenuItems.size(); i++){
+        mMenuItems[i].surfIdle = mMenuItems[i].surfSelected = nullptr;
+        mMenuItems[i].texIdle = mMenuItems[i].texSelected = nullptr;
+    }
 
     // Hehe... tripped myself up...
     // NOTHING AFTER THIS LINE!!
@@ -207,11 +218,37 @@ MainMenu::MainMenu(engine::GameStateManagerHnd gsm){
 
 MainMenu::~MainMenu(){
     stop();
-    clearCodeStreamTextures();
 }
 
 
 
+void MainMenu::prepare(){
+    // Everything in here runs on a worker thread when the menu is preloaded, so no textures and no renderer.
+    if (mPrepared){
+        return;
+    }
+
+    mWriter = engine::Writer::getHandle();
+    if (!mWriter.IsValid()){
+        throw std::runtime_error("Failed to obtain Writer object.");
+    }
+    if (!mWriter->hasFont("default8") || !mWriter->hasFont("default12") || !mWriter->hasFont("default24")){
+        throw std::runtime_error("Required font not defined.");
+    }
+    setPrepareProgress(0.1f);
+
+    preRenderMenuItems();
+    setPrepareProgress(0.8f);
+
+    // Now split that really big const string defined at the top of this file into vector.
+    splitString(CODE_STREAM_TEXT, "\n", &mCodeStreamList);
+    mCodeStreamPanel = engine::TextPanelPtr(new engine::TextPanel("default12", 400, 400));
+    SDL_Color codeColor = {64, 255, 64, 255};
+    mCodeStreamPanel->setColor(codeColor);
+    setPrepareProgress(1.0f);
+    mPrepared = true;
+}
+
 void MainMenu::start(){
     // First either, get or create the main window.
     engine::WindowManager* wm = engine::WindowManager::getInstance();
@@ -234,23 +271,21 @@ void MainMenu::start(){
         throw std::runtime_error("Failed to obtain texture resource.");
     }*/
 
-    mWriter = engine::Writer::getHandle();
-    if (!mWriter.IsValid()){
-        throw std::runtime_error("Failed to obtain Writer object.");
-    }
-    if (!mWriter->hasFont("default8") || !mWriter->hasFont("default12") || !mWriter->hasFont("default24")){
-        throw std::runtime_error("Required font not defined.");
-    }
-    //mWriter->setPenColor(64, 255, 64);
-    preRenderMenuItems();
-
-    // Now split that really big const string defined at the top of this file into vector.
-    splitString(CODE_STREAM_TEXT, "\n", &mCodeStreamList);
+    // Does nothing if the menu was preloaded, leaving only the texture uploads for the main thread.
+    prepare();
+    uploadMenuItems();
+    addLayers();
     mHasFocus = true;
 }
 
 void MainMenu::stop(){
+    if (mWindow.IsValid()){
+        mWindow->removeLayer(LAYER_MENU_ITEMS_NAME);
+        mWindow->removeLayer(LAYER_CODE_STREAM_NAME);
+    }
     for (int i = 0; i < mMenuItems.size(); i++){
+        SDL_FreeSurface(mMenuItems.at(i).surfIdle);
+        SDL_FreeSurface(mMenuItems.at(i).surfSelected);
         SDL_DestroyTexture(mMenuItems.at(i).texIdle);
         SDL_DestroyTexture(mMenuItems.at(i).texSelected);
     }
@@ -265,122 +300,58 @@ void MainMenu::looseFocus(){
         mHasFocus = false;
 }
 
+unsigned int MainMenu::idleUntil(){
+    if (!mHasFocus){
+        return IDLE_FOREVER;
+    }
+    if (!mCodeStreamTimer.started()){
+        return 0;
+    }
+    // Nothing moves between lines of the code stream.
+    return SDL_GetTicks() + mCodeStreamTimer.ticksToNextStep();
+}
+
 void MainMenu::update(){
     if (mHasFocus){
         if (!mCodeStreamTimer.started()){mCodeStreamTimer.start(50);}
-        updateCodeStream(mCodeStreamTimer.steps(), 400);
+        updateCodeStream(mCodeStreamTimer.steps());
     }
 }
 
 void MainMenu::render(){
-    SDL_Rect src;
-    SDL_Rect dst;
-
     if (mHasFocus && mWindow.IsValid()){
-        mWindow->clear();
-
-        mWindow->setPenColor(0, 255, 0);
-        //mWindow->drawLine(0, 5, 200, 5);
-        //mTexBackground->render(0, 0);
-        //if (mWriter.IsValid()){
-        //    mWriter->presentToWindow(mWindow, "default", "On a dark and stormy night in the middle of the universe", 10, 10);
-        //}
-
-        dst.x = 50;
-        dst.y = 200;
-        for (int i = 0; i < mMenuItems.size(); i++){
-            SDL_Texture* tex = nullptr;
-            if (mMenuItemID == i){
-                tex = mMenuItems.at(i).texSelected;
-            } else {
-                tex = mMenuItems.at(i).texIdle;
-            }
-
-            SDL_QueryTexture(tex, nullptr, nullptr, &src.w, &src.h);
-            src.x = src.y = 0;
-            dst.w = src.w;
-            dst.h = src.h;
-            mWindow->render(tex, &src, &dst);
-            dst.y += src.h+2;
-        }
-
-        renderCodeStream(1240, 400, 400, 400);
-        mWindow->present();
+        // Both layers only redraw when marked dirty; most frames this is two texture copies.
+        mWindow->compositeLayers();
     }
 }
 
 
 // PRIVATE
-void MainMenu::updateCodeStream(int steps, int viewHeight){
-    if (steps > 0 && mWindow.IsValid() && mWriter.IsValid()){
-        int fontHeight = mWriter->getFontPixelHeight("default12");
-
-        if (mCodeStreamList.size() > 0 && fontHeight > 0 && viewHeight > 0 && viewHeight > fontHeight){
-            int maxViewableLines = viewHeight/fontHeight;
-
-            mWriter->setPenColor(64, 255, 64);
-            // Ok... now... I'm managing an EXTREAM case where there could be a HUGE delay between calls.
-            if (steps > maxViewableLines){
-                mCodeStreamIndex = maxViewableLines - ((mCodeStreamIndex+steps)%maxViewableLines);
-                clearCodeStreamTextures();
-                for (int i = 0; i < maxViewableLines; i++){
-                    SDL_Texture* tex = mWriter->textToTexture(mWindow, "default12", mCodeStreamList.at(mCodeStreamIndex));
-                    mCodeStreamIndex++;
-                    if (mCodeStreamIndex >= mCodeStreamList.size())
-                        mCodeStreamIndex = 0;
-
-                    if (tex != nullptr){
-                        mCodeStreamTextures.push_back(tex);
-                    }
-                }
-            } else {
-                for (int i = 0; i < steps; i++){
-                    // Build the new string texture and store it.
-                    SDL_Texture* tex = mWriter->textToTexture(mWindow, "default12", mCodeStreamList.at(mCodeStreamIndex));
-                    mCodeStreamIndex++;
-                    if (mCodeStreamIndex >= mCodeStreamList.size())
-                        mCodeStreamIndex = 0;
-
-                    if (tex != nullptr){
-                        // If we already have maxViewableLines of textures, destroy and remove the oldest one.
-                        while (mCodeStreamTextures.size() >= maxViewableLines){
-                            SDL_DestroyTexture(mCodeStreamTextures.front());
-                            mCodeStreamTextures.erase(mCodeStreamTextures.begin());
-                        }
-                        mCodeStreamTextures.push_back(tex);
-                    }
-                }
-            }
+void MainMenu::updateCodeStream(int steps){
+    if (steps > 0 && mCodeStreamList.size() > 0){
+        // Ok... now... I'm managing an EXTREAM case where there could be a HUGE delay between calls.
+        // Lines that would scroll straight through the panel are skipped.
+        size_t capacity = mCodeStreamPanel->capacity();
+        if (static_cast<size_t>(steps) > capacity){
+            mCodeStreamIndex = (mCodeStreamIndex + (steps - capacity)) % mCodeStreamList.size();
+            steps = static_cast<int>(capacity);
+        }
+        for (int i = 0; i < steps; i++){
+            mCodeStreamPanel->push(mCodeStreamList.at(mCodeStreamIndex));
+            mCodeStreamIndex++;
+            if (mCodeStreamIndex >= mCodeStreamList.size())
+                mCodeStreamIndex = 0;
+        }
+        if (mWindow.IsValid()){
+            // Every line moves up, so the whole panel is redrawn.
+            mWindow->markLayerDirty(LAYER_CODE_STREAM_NAME);
         }
     }
 }
 
 // PRIVATE
-void MainMenu::renderCodeStream(int x, int y, int viewWidth, int viewHeight){
-    SDL_Rect dst;
-    dst.x = x;
-    dst.y = y;
-
-    if (mWindow.IsValid() && mWriter.IsValid() && mCodeStreamTextures.size() > 0){
-        int fontHeight = mWriter->getFontPixelHeight("default12");
-
-        // Render the string textures we have!
-        for (int index = 0; index < mCodeStreamTextures.size(); index++){
-            SDL_Texture* t = mCodeStreamTextures.at(index);
-            SDL_Rect src;
-            src.x = 0;
-            src.y = 0;
-            SDL_QueryTexture(t, nullptr, nullptr, &src.w, &src.h);
-            if (src.w > viewWidth){
-                src.w = viewWidth;
-            }
-            dst.w = src.w;
-            dst.h = src.h;
-
-            mWindow->render(t, &src, &dst);
-            dst.y += fontHeight;
-        }
-    }
+void MainMenu::paintCodeStream(const SDL_Rect &){
+    mCodeStreamPanel->draw(mWindow, 0, 0);
 }
 
 
@@ -390,10 +361,7 @@ bool MainMenu::poll(SDL_Event event){
     {
         // exit if the window is closed
     case SDL_QUIT:
-        if (mGameStateManager.IsValid()){
-            // THIS state should have focus when this occures, we we're dropping ourselved here!
-            mGameStateManager->dropState();
-        }
+        quit();
         return true;
 
         // check for keypresses
@@ -401,24 +369,28 @@ bool MainMenu::poll(SDL_Event event){
         {
             // exit if ESCAPE is pressed
             if (event.key.keysym.sym == SDLK_ESCAPE){
-                if (mGameStateManager.IsValid()){
-                    // THIS state should have focus when this occures, we we're dropping ourselved here!
-                    mGameStateManager->dropState();
-                }
+                quit();
+            } else if (event.key.keysym.sym == SDLK_F3){
+                toggleProfilerOverlay();
             } else if (event.key.keysym.sym == SDLK_DOWN){
                 if (mMenuItemID < mMenuItems.size()-1){
+                    markMenuItemDirty(mMenuItemID);
                     mMenuItemID++;
+                    markMenuItemDirty(mMenuItemID);
                 }
             } else if (event.key.keysym.sym == SDLK_UP){
                 if (mMenuItemID > 0){
+                    markMenuItemDirty(mMenuItemID);
                     mMenuItemID--;
+                    markMenuItemDirty(mMenuItemID);
                 }
             } else if (event.key.keysym.sym == SDLK_RETURN){
                 if (mMenuItems.at(mMenuItemID).itemName == std::string("Quit")){
-                    if (mGameStateManager.IsValid()){
-                        mGameStateManager->dropState();
-                    }
+                    quit();
                 }
+            } else {
+                // Leave keys we don't use to the states above us.
+                return false;
             }
             return true;
         }
@@ -427,13 +399,29 @@ bool MainMenu::poll(SDL_Event event){
 }
 
 // PRIVATE
-void MainMenu::clearCodeStreamTextures(){
-    while (!mCodeStreamTextures.empty()){
-        SDL_DestroyTexture(mCodeStreamTextures.back());
-        mCodeStreamTextures.pop_back();
+void MainMenu::toggleProfilerOverlay(){
+    if (mGameStateManager.IsValid()){
+        if (mProfilerOverlay.get() != 0 && mGameStateManager->currentState() == mProfilerOverlay){
+            mGameStateManager->dropState();
+        } else {
+            if (mProfilerOverlay.get() == 0){
+                mProfilerOverlay = engine::StatePtr(new engine::ProfilerOverlay(mWindow, "default12"));
+            }
+            mGameStateManager->addState(mProfilerOverlay);
+        }
     }
 }
 
+// PRIVATE
+void MainMenu::quit(){
+    if (mGameStateManager.IsValid()){
+        if (mProfilerOverlay.get() != 0 && mGameStateManager->currentState() == mProfilerOverlay){
+            mGameStateManager->dropState();
+        }
+        // THIS state should have focus when this occures, we we're dropping ourselved here!
+        mGameStateManager->dropState();
+    }
+}
 
 void MainMenu::splitString(std::string s, std::string delimiter, std::vector<std::string> *container){
     // Code modified from original source supplied by "Vincenzo Pii" at
@@ -449,16 +437,83 @@ void MainMenu::splitString(std::string s, std::string delimiter, std::vector<std
 
 
 void MainMenu::preRenderMenuItems(){
+    // Explicit colors rather than the Writer's pen, as the pen is shared with whatever the main thread is drawing.
+    SDL_Color idle = {64, 128, 64, 255};
+    SDL_Color selected = {64, 255, 64, 255};
     for (int n = 0; n < mMenuItems.size(); n++){
         sMenuItemInfo* i = &mMenuItems.at(n);
         mWriter->getFontStringTextSize("default24", i->itemName, &i->width, &i->height);
 
-        mWriter->setPenColor(64, 128, 64);
-        i->texIdle = mWriter->textToTexture(mWindow, "default24", i->itemName);
-        mWriter->setPenColor(64, 255, 64);
-        i->texSelected = mWriter->textToTexture(mWindow, "default24", i->itemName);
+        i->surfIdle = mWriter->textToSurface("default24", i->itemName, idle);
+        i->surfSelected = mWriter->textToSurface("default24", i->itemName, selected);
     }
 }
 
 
+void MainMenu::uploadMenuItems(){
+    for (int n = 0; n < mMenuItems.size(); n++){
+        sMenuItemInfo* i = &mMenuItems.at(n);
+        if (i->surfIdle != nullptr){
+            i->texIdle = mWindow->textureFromSurface(i->surfIdle);
+            SDL_FreeSurface(i->surfIdle);
+            i->surfIdle = nullptr;
+        }
+        if (i->surfSelected != nullptr){
+            i->texSelected = mWindow->textureFromSurface(i->surfSelected);
+            SDL_FreeSurface(i->surfSelected);
+            i->surfSelected = nullptr;
+        }
+    }
+}
+
+
+void MainMenu::addLayers(){
+    SDL_Rect items = {50, 200, 0, 0};
+    for (int n = 0; n < mMenuItems.size(); n++){
+        items.w = std::max(items.w, mMenuItems.at(n).width);
+        items.h += mMenuItems.at(n).height + 2;
+    }
+    mWindow->addLayer(LAYER_MENU_ITEMS_NAME, 0, boost::bind(&MainMenu::paintMenuItems, this, _1), &items);
+
+    // Kept inside the logical screen, however narrow; off screen, it would only be culled.
+    SDL_Rect codeStream = {1240, 400, mCodeStreamPanel->width(), mCodeStreamPanel->height()};
+    if (mLogicalRenderWidth > 0){
+        codeStream.x = std::max(0, std::min(codeStream.x, mLogicalRenderWidth - codeStream.w));
+    }
+    mWindow->addLayer(LAYER_CODE_STREAM_NAME, 0, boost::bind(&MainMenu::paintCodeStream, this, _1), &codeStream);
+}
+
+void MainMenu::paintMenuItems(const SDL_Rect &dirty){
+    SDL_Rect src;
+    SDL_Rect dst;
+    dst.x = 0;
+    dst.y = 0;
+    for (int i = 0; i < mMenuItems.size(); i++){
+        const sMenuItemInfo &item = mMenuItems.at(i);
+        SDL_Texture* tex = (mMenuItemID == i) ? item.texSelected : item.texIdle;
 
+        src.x = src.y = 0;
+        src.w = dst.w = item.width;
+        src.h = dst.h = item.height;
+        if (SDL_HasIntersection(&dst, &dirty)){
+            mWindow->render(tex, &src, &dst);
+        }
+        dst.y += item.height + 2;
+    }
+}
+
+void MainMenu::markMenuItemDirty(int id){
+    if (!mWindow.IsValid()){
+        return;
+    }
+    SDL_Rect row = {0, 0, 0, 0};
+    for (int i = 0; i < mMenuItems.size(); i++){
+        if (i == id){
+            row.w = mMenuItems.at(i).width;
+            row.h = mMenuItems.at(i).height;
+            mWindow->markLayerDirty(LAYER_MENU_ITEMS_NAME, &row);
+            return;
+        }
+        row.y += mMenuItems.at(i).height + 2;
+    }
+}
@@ -39,11 +39,15 @@
 #include "engine/WindowManager.h"
 #include "engine/TextureManager.h"
 #include "engine/Writer.h"
+#include "engine/TextPanel.h"
 #include "engine/Timer.h"
+#include "engine/ProfilerOverlay.h"
 
 
 struct sMenuItemInfo{
     std::string itemName;
+    SDL_Surface* surfIdle;
+    SDL_Surface* surfSelected;
     SDL_Texture* texIdle;
     SDL_Texture* texSelected;
     int width;
@@ -57,11 +61,13 @@ class MainMenu : public engine::IState, public engine::IIOState, public engine::
         MainMenu(engine::GameStateManagerHnd gsm);
         ~MainMenu();
 
+        void prepare();
         void start();
         void stop();
 
         void getFocus();
         void looseFocus();
+        unsigned int idleUntil();
 
         void update();
         void render();
@@ -70,12 +76,15 @@ class MainMenu : public engine::IState, public engine::IIOState, public engine::
     private:
         static const std::string TEXTURE_BACKGROUND_NAME;
         static const std::string CODE_STREAM_TEXT;
+        static const std::string LAYER_MENU_ITEMS_NAME;
+        static const std::string LAYER_CODE_STREAM_NAME;
 
         engine::GameStateManagerHnd mGameStateManager;
         engine::WriterHnd mWriter;
         engine::WindowHnd mWindow;
         engine::TextureHnd mTexBackground;
         bool mHasFocus;
+        bool mPrepared;
         int mLogicalRenderWidth;
         int mLogicalRenderHeight;
 
@@ -86,16 +95,31 @@ class MainMenu : public engine::IState, public engine::IIOState, public engine::
 
         std::vector<std::string> mCodeStreamList;
         int mCodeStreamIndex;
-        std::vector<SDL_Texture*> mCodeStreamTextures;
+        engine::TextPanelPtr mCodeStreamPanel;
         Timer mCodeStreamTimer;
 
         void splitString(std::string s, std::string delimiter, std::vector<std::string> *container);
 
-        void updateCodeStream(int steps, int viewHeight);
-        void renderCodeStream(int x, int y, int viewWidth, int viewHeight);
-        void clearCodeStreamTextures();
+        void updateCodeStream(int steps);
+        void paintCodeStream(const SDL_Rect &);
 
         void preRenderMenuItems();
+        void uploadMenuItems();
+
+        /**
+        * Adds the window layers the menu items and the code stream are drawn into. They're redrawn only when they change.
+        */
+        void addLayers();
+        void paintMenuItems(const SDL_Rect &dirty);
+        void markMenuItemDirty(int id);
+
+        engine::StatePtr mProfilerOverlay;
+        void toggleProfilerOverlay();
+
+        /**
+        * Drops this state (and the profiler overlay, if it's shown) from the state manager.
+        */
+        void quit();
 };
 
 #endif // MAINMENU_H
@@ -0,0 +1,295 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "Archive.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define ARCHIVE_USE_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+
+namespace engine{
+
+
+namespace {
+    const char ARCHIVE_MAGIC[4] = {'S', 'F', 'P', 'K'};
+
+    uint64_t ReadLE(const char* p, int bytes){
+        uint64_t value = 0;
+        for (int i = bytes-1; i >= 0; i--){
+            value = (value << 8) | static_cast<unsigned char>(p[i]);
+        }
+        return value;
+    }
+
+    void WriteLE(std::vector<char> &out, uint64_t value, int bytes){
+        for (int i = 0; i < bytes; i++){
+            out.push_back(static_cast<char>((value >> (i*8)) & 0xFF));
+        }
+    }
+
+    bool ReadFile(const std::string &path, std::vector<char> &out){
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr){
+            return false;
+        }
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        out.resize(size > 0 ? static_cast<size_t>(size) : 0);
+        bool ok = out.empty() || fread(&out[0], 1, out.size(), file) == out.size();
+        fclose(file);
+        return ok;
+    }
+}
+
+
+Archive::Archive(const std::string &path) : mPath(path), mData(nullptr), mSize(0){
+    Map();
+    try{
+        ReadIndex();
+    } catch (std::runtime_error e){
+        Unmap();
+        throw e;
+    }
+}
+
+Archive::~Archive(){
+    Unmap();
+}
+
+bool Archive::has(const std::string &path){
+    return mIndex.find(Normalize(path)) != mIndex.end();
+}
+
+const Archive::sEntry* Archive::find(const std::string &path){
+    EntryIndex::iterator item = mIndex.find(Normalize(path));
+    if (item != mIndex.end()){
+        return &item->second;
+    }
+    return nullptr;
+}
+
+const char* Archive::storedData(const sEntry &entry){
+    return mData + entry.offset;
+}
+
+bool Archive::inflate(const sEntry &entry, std::vector<char> &out){
+    out.resize(static_cast<size_t>(entry.size));
+    if (!(entry.flags & Entry_Deflate)){
+        if (entry.size > 0){
+            memcpy(&out[0], storedData(entry), static_cast<size_t>(entry.size));
+        }
+        return true;
+    }
+    uLongf size = static_cast<uLongf>(entry.size);
+    int result = uncompress(reinterpret_cast<Bytef*>(out.empty() ? nullptr : &out[0]), &size, reinterpret_cast<const Bytef*>(storedData(entry)), static_cast<uLong>(entry.storedSize));
+    return result == Z_OK && size == entry.size;
+}
+
+void Archive::getPaths(std::vector<std::string> &paths){
+    paths.clear();
+    for (EntryIndex::iterator item = mIndex.begin(); item != mIndex.end(); item++){
+        paths.push_back(item->first);
+    }
+}
+
+std::string Archive::getPath(){
+    return mPath;
+}
+
+
+void Archive::Pack(const std::string &archivePath, const PackList &items, bool compress){
+    std::vector<char> data;
+    std::vector<char> index;
+    std::vector<char> source;
+    std::vector<char> packed;
+
+    // The data section starts right after the header.
+    data.resize(HEADER_SIZE, 0);
+    for (size_t i = 0; i < items.size(); i++){
+        if (!ReadFile(items[i].second, source)){
+            throw std::runtime_error(std::string("Failed to read \"") + items[i].second + std::string("\"."));
+        }
+
+        uint32_t flags = Entry_Stored;
+        const std::vector<char>* stored = &source;
+        if (compress && !source.empty()){
+            uLongf packedSize = compressBound(static_cast<uLong>(source.size()));
+            packed.resize(packedSize);
+            if (compress2(reinterpret_cast<Bytef*>(&packed[0]), &packedSize, reinterpret_cast<const Bytef*>(&source[0]), static_cast<uLong>(source.size()), Z_BEST_COMPRESSION) == Z_OK && packedSize < source.size()){
+                packed.resize(packedSize);
+                stored = &packed;
+                flags = Entry_Deflate;
+            }
+        }
+
+        while (data.size() % ALIGNMENT != 0){
+            data.push_back(0);
+        }
+        uint64_t offset = data.size();
+        data.insert(data.end(), stored->begin(), stored->end());
+
+        std::string path = Normalize(items[i].first);
+        WriteLE(index, offset, 8);
+        WriteLE(index, stored->size(), 8);
+        WriteLE(index, source.size(), 8);
+        WriteLE(index, flags, 4);
+        WriteLE(index, path.size(), 2);
+        index.insert(index.end(), path.begin(), path.end());
+    }
+
+    std::vector<char> header;
+    header.insert(header.end(), ARCHIVE_MAGIC, ARCHIVE_MAGIC + 4);
+    WriteLE(header, VERSION, 4);
+    WriteLE(header, items.size(), 4);
+    WriteLE(header, ALIGNMENT, 4);
+    WriteLE(header, data.size(), 8);
+    WriteLE(header, index.size(), 8);
+    memcpy(&data[0], &header[0], HEADER_SIZE);
+
+    FILE* file = fopen(archivePath.c_str(), "wb");
+    if (file == nullptr){
+        throw std::runtime_error(std::string("Failed to create archive \"") + archivePath + std::string("\"."));
+    }
+    bool ok = fwrite(&data[0], 1, data.size(), file) == data.size();
+    ok = ok && (index.empty() || fwrite(&index[0], 1, index.size(), file) == index.size());
+    ok = (fclose(file) == 0) && ok;
+    if (!ok){
+        throw std::runtime_error(std::string("Failed to write archive \"") + archivePath + std::string("\"."));
+    }
+}
+
+std::string Archive::Normalize(const std::string &path){
+    std::string normalized;
+    normalized.reserve(path.size());
+    size_t start = 0;
+    while (start <= path.size()){
+        size_t end = path.find_first_of("/\\", start);
+        if (end == std::string::npos){
+            end = path.size();
+        }
+        std::string segment = path.substr(start, end - start);
+        if (segment != "" && segment != "."){
+            if (!normalized.empty()){
+                normalized += '/';
+            }
+            normalized += segment;
+        }
+        start = end + 1;
+    }
+    return normalized;
+}
+
+
+// PRIVATE
+
+void Archive::Map(){
+#ifdef ARCHIVE_USE_MMAP
+    int fd = open(mPath.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw std::runtime_error(std::string("Failed to open archive \"") + mPath + std::string("\"."));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0){
+        close(fd);
+        throw std::runtime_error(std::string("Failed to open archive \"") + mPath + std::string("\"."));
+    }
+    void* map = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file.
+    close(fd);
+    if (map == MAP_FAILED){
+        throw std::runtime_error(std::string("Failed to map archive \"") + mPath + std::string("\"."));
+    }
+    mData = static_cast<const char*>(map);
+    mSize = static_cast<size_t>(info.st_size);
+#else
+    if (!ReadFile(mPath, mBuffer) || mBuffer.empty()){
+        throw std::runtime_error(std::string("Failed to open archive \"") + mPath + std::string("\"."));
+    }
+    mData = &mBuffer[0];
+    mSize = mBuffer.size();
+#endif
+}
+
+void Archive::Unmap(){
+#ifdef ARCHIVE_USE_MMAP
+    if (mData != nullptr){
+        munmap(const_cast<char*>(mData), mSize);
+    }
+#else
+    mBuffer.clear();
+#endif
+    mData = nullptr;
+    mSize = 0;
+}
+
+void Archive::ReadIndex(){
+    if (mSize < HEADER_SIZE || memcmp(mData, ARCHIVE_MAGIC, 4) != 0){
+        throw std::runtime_error(std::string("\"") + mPath + std::string("\" is not an archive."));
+    }
+    if (ReadLE(mData + 4, 4) != VERSION){
+        throw std::runtime_error(std::string("Archive \"") + mPath + std::string("\" is of an unsupported version."));
+    }
+    uint64_t count = ReadLE(mData + 8, 4);
+    uint64_t indexOffset = ReadLE(mData + 16, 8);
+    uint64_t indexSize = ReadLE(mData + 24, 8);
+    if (indexOffset > mSize || indexSize > mSize - indexOffset){
+        throw std::runtime_error(std::string("Archive \"") + mPath + std::string("\" is truncated."));
+    }
+
+    const char* p = mData + indexOffset;
+    const char* end = p + indexSize;
+    mIndex.reserve(static_cast<size_t>(count));
+    for (uint64_t i = 0; i < count; i++){
+        if (end - p < 30){
+            throw std::runtime_error(std::string("Archive \"") + mPath + std::string("\" has a corrupt index."));
+        }
+        sEntry entry;
+        entry.offset = ReadLE(p, 8);
+        entry.storedSize = ReadLE(p + 8, 8);
+        entry.size = ReadLE(p + 16, 8);
+        entry.flags = static_cast<uint32_t>(ReadLE(p + 24, 4));
+        size_t pathLength = static_cast<size_t>(ReadLE(p + 28, 2));
+        p += 30;
+        if (static_cast<size_t>(end - p) < pathLength || entry.offset > mSize || entry.storedSize > mSize - entry.offset){
+            throw std::runtime_error(std::string("Archive \"") + mPath + std::string("\" has a corrupt index."));
+        }
+        mIndex[std::string(p, pathLength)] = entry;
+        p += pathLength;
+    }
+}
+
+
+} // End namespace "engine"
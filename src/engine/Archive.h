@@ -0,0 +1,134 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace engine{
+
+class Archive;
+/** \typedef
+* \brief std::shared_ptr<Archive>
+*/
+typedef std::shared_ptr<Archive> ArchivePtr;
+
+/** \class
+* \brief A read-only packed asset archive, memory mapped for its whole lifetime.
+*
+* Layout (all integers little endian):
+*   Header  - "SFPK", uint32 version, uint32 entry count, uint32 alignment, uint64 index offset, uint64 index size.
+*   Data    - Each entry's bytes, starting on a multiple of the alignment.
+*   Index   - Per entry: uint64 offset, uint64 stored size, uint64 size, uint32 flags, uint16 path length, path bytes.
+*
+* Entries flagged Entry_Deflate are zlib streams that inflate to size bytes. All others are stored as is and are read in
+* place, straight out of the mapping. Paths are stored normalized (see Normalize).
+*/
+class Archive
+{
+    public:
+        enum EntryFlags {
+            Entry_Stored = 0,
+            Entry_Deflate = 1   /**< The entry is zlib compressed. */
+        };
+
+        struct sEntry{
+            uint64_t offset;
+            uint64_t storedSize;
+            uint64_t size;
+            uint32_t flags;
+        };
+
+        static const uint32_t VERSION = 1;
+        static const uint32_t ALIGNMENT = 16;
+        static const size_t HEADER_SIZE = 32;
+
+        /**
+        * Maps the archive at the given path and reads its index. Throws a runtime_error if it can't be opened or isn't a
+        * valid archive.
+        */
+        Archive(const std::string &path);
+        ~Archive();
+
+        bool has(const std::string &path);
+
+        /**
+        * Returns the entry stored under the (normalized) path, or nullptr.
+        */
+        const sEntry* find(const std::string &path);
+
+        /**
+        * Returns a pointer to the stored bytes of an entry, inside the mapping. Valid for as long as the archive is.
+        */
+        const char* storedData(const sEntry &entry);
+
+        /**
+        * Fills out with the entry's contents, inflating it if it's compressed. Returns false if it couldn't be inflated.
+        */
+        bool inflate(const sEntry &entry, std::vector<char> &out);
+
+        void getPaths(std::vector<std::string> &paths);
+        std::string getPath();
+
+        /** \typedef A (path in the archive, source file) pair */
+        typedef std::pair<std::string, std::string> PackItem;
+        typedef std::vector<PackItem> PackList;
+
+        /**
+        * Writes an archive holding the given files. When compress is true, entries are deflated where that makes them smaller.
+        * Throws a runtime_error if a file can't be read or the archive can't be written.
+        */
+        static void Pack(const std::string &archivePath, const PackList &items, bool compress);
+
+        /**
+        * Converts a path to the form used as a key in archives: forward slashes, no "./" segments or leading slash.
+        */
+        static std::string Normalize(const std::string &path);
+
+    private:
+        std::string mPath;
+        const char* mData;
+        size_t mSize;
+        // Only used where memory mapping isn't available, in which case the whole archive is read into it.
+        std::vector<char> mBuffer;
+
+        typedef std::unordered_map<std::string, sEntry> EntryIndex;
+        EntryIndex mIndex;
+
+        void Map();
+        void Unmap();
+        void ReadIndex();
+};
+
+
+} // End namespace "engine"
+
+#endif // ARCHIVE_H
@@ -0,0 +1,149 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "AtlasPacker.h"
+
+
+namespace engine{
+
+
+AtlasPacker::AtlasPacker(int width, int height) : mWidth(width), mHeight(height){
+    reset();
+}
+
+bool AtlasPacker::insert(int width, int height, SDL_Rect &rect){
+    if (width <= 0 || height <= 0){
+        return false;
+    }
+
+    int bestY = mHeight;
+    int bestWidth = mWidth + 1;
+    size_t bestIndex = mSkyline.size();
+    for (size_t index = 0; index < mSkyline.size(); index++){
+        int y = Fit(index, width, height);
+        if (y >= 0){
+            // Lowest position first, then the narrowest skyline segment to waste less space beside it.
+            if (y < bestY || (y == bestY && mSkyline[index].width < bestWidth)){
+                bestY = y;
+                bestWidth = mSkyline[index].width;
+                bestIndex = index;
+            }
+        }
+    }
+    if (bestIndex == mSkyline.size()){
+        return false;
+    }
+
+    rect.x = mSkyline[bestIndex].x;
+    rect.y = bestY;
+    rect.w = width;
+    rect.h = height;
+    AddLevel(bestIndex, rect);
+    mUsedArea += static_cast<long>(width)*height;
+    return true;
+}
+
+void AtlasPacker::reset(){
+    mUsedArea = 0;
+    mSkyline.clear();
+    sSkylineNode node = {0, 0, mWidth};
+    mSkyline.push_back(node);
+}
+
+int AtlasPacker::width(){
+    return mWidth;
+}
+
+int AtlasPacker::height(){
+    return mHeight;
+}
+
+float AtlasPacker::occupancy(){
+    if (mWidth <= 0 || mHeight <= 0){
+        return 0.0f;
+    }
+    return static_cast<float>(mUsedArea)/(static_cast<float>(mWidth)*mHeight);
+}
+
+
+// PRIVATE
+
+int AtlasPacker::Fit(size_t index, int width, int height){
+    int x = mSkyline[index].x;
+    if (x + width > mWidth){
+        return -1;
+    }
+
+    // The rectangle rests on the highest skyline segment it spans.
+    int y = 0;
+    int remaining = width;
+    for (size_t i = index; remaining > 0; i++){
+        if (i >= mSkyline.size()){
+            return -1;
+        }
+        if (mSkyline[i].y > y){
+            y = mSkyline[i].y;
+        }
+        if (y + height > mHeight){
+            return -1;
+        }
+        remaining -= mSkyline[i].width;
+    }
+    return y;
+}
+
+void AtlasPacker::AddLevel(size_t index, const SDL_Rect &rect){
+    sSkylineNode node = {rect.x, rect.y + rect.h, rect.w};
+    mSkyline.insert(mSkyline.begin() + index, node);
+
+    // Trim or remove the segments now covered by the new one.
+    for (size_t i = index + 1; i < mSkyline.size(); ){
+        sSkylineNode &prev = mSkyline[i-1];
+        int prevRight = prev.x + prev.width;
+        if (mSkyline[i].x >= prevRight){
+            break;
+        }
+        int shrink = prevRight - mSkyline[i].x;
+        mSkyline[i].x += shrink;
+        mSkyline[i].width -= shrink;
+        if (mSkyline[i].width <= 0){
+            mSkyline.erase(mSkyline.begin() + i);
+        } else {
+            break;
+        }
+    }
+
+    // Merge neighbouring segments of the same height.
+    for (size_t i = 0; i + 1 < mSkyline.size(); ){
+        if (mSkyline[i].y == mSkyline[i+1].y){
+            mSkyline[i].width += mSkyline[i+1].width;
+            mSkyline.erase(mSkyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+}
+
+
+} // End namespace "engine"
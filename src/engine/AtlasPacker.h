@@ -0,0 +1,85 @@
+#ifndef ATLASPACKER_H
+#define ATLASPACKER_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+
+namespace engine{
+
+
+/** \class
+* \brief Skyline bottom-left rectangle packer, used to lay images out on texture atlas pages.
+*
+* The skyline is the outline of everything packed so far. Each rectangle is placed at the lowest point along it where it
+* fits (leftmost on ties), which packs well for sprites that are inserted roughly tallest first.
+*/
+class AtlasPacker
+{
+    public:
+        AtlasPacker(int width, int height);
+
+        /**
+        * Finds room for a width x height rectangle. Returns false, leaving rect untouched, if the page has none left.
+        */
+        bool insert(int width, int height, SDL_Rect &rect);
+
+        /**
+        * Empties the page.
+        */
+        void reset();
+
+        int width();
+        int height();
+
+        /**
+        * Fraction of the page covered by inserted rectangles.
+        */
+        float occupancy();
+
+    private:
+        struct sSkylineNode{
+            int x;
+            int y;
+            int width;
+        };
+
+        int mWidth;
+        int mHeight;
+        long mUsedArea;
+        std::vector<sSkylineNode> mSkyline;
+
+        /** Returns the y a rectangle placed at the given node would rest at, or -1 if it doesn't fit there. */
+        int Fit(size_t index, int width, int height);
+        void AddLevel(size_t index, const SDL_Rect &rect);
+};
+
+
+} // End namespace "engine"
+
+#endif // ATLASPACKER_H
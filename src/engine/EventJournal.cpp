@@ -0,0 +1,467 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "EventJournal.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace engine{
+
+
+EventJournalPtr EventJournal::mInstance;
+
+const char EventJournal::MAGIC[4] = {'S', 'F', 'E', 'J'};
+const Uint8 EventJournal::VERSION = 1;
+
+
+// Journal reading helpers. All of these throw if the buffer runs out before the value does.
+static Uint8 ReadByte(const std::string &buf, size_t &pos){
+    if (pos >= buf.size()){
+        throw std::runtime_error("Truncated event journal.");
+    }
+    return static_cast<Uint8>(buf[pos++]);
+}
+
+static Uint64 ReadVarint(const std::string &buf, size_t &pos){
+    Uint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7){
+        Uint8 b = ReadByte(buf, pos);
+        value |= static_cast<Uint64>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0){
+            return value;
+        }
+    }
+    throw std::runtime_error("Malformed varint in event journal.");
+}
+
+static Uint64 ReadFixed(const std::string &buf, size_t &pos, int bytes){
+    Uint64 value = 0;
+    for (int i = 0; i < bytes; i++){
+        value |= static_cast<Uint64>(ReadByte(buf, pos)) << (i*8);
+    }
+    return value;
+}
+
+static std::string ReadString(const std::string &buf, size_t &pos){
+    size_t len = static_cast<size_t>(ReadVarint(buf, pos));
+    if (len > buf.size() - pos){
+        throw std::runtime_error("Truncated event journal.");
+    }
+    std::string s = buf.substr(pos, len);
+    pos += len;
+    return s;
+}
+
+
+
+EventJournal::EventJournal() : mMode(Mode_Idle), mFrame(0), mLastWrittenFrame(0), mLastFrame(0), mDivergences(0),
+                               mInjectQueuedEvents(false), mRecordIndex(0), mFrameUpdateSteps(0){}
+
+EventJournal::~EventJournal(){
+    stop();
+}
+
+EventJournalPtr EventJournal::getInstance(){
+    if (mInstance.get() == 0){
+        mInstance = EventJournalPtr(new EventJournal());
+    }
+    return mInstance;
+}
+
+
+void EventJournal::UseHeadlessVideo(){
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+}
+
+
+void EventJournal::startRecording(const std::string &path){
+    stop();
+
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    mOut.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!mOut){
+        throw std::runtime_error(std::string("Failed to open event journal \"") + path + std::string("\" for writing."));
+    }
+    mOut.write(MAGIC, 4);
+    mOut.put(static_cast<char>(VERSION));
+    mOut.put(static_cast<char>(sizeof(SDL_Event)));
+
+    mFrame = 0;
+    mLastWrittenFrame = 0;
+    mMode = Mode_Record;
+}
+
+void EventJournal::startReplay(const std::string &path, bool injectQueuedEvents){
+    stop();
+
+    {
+        boost::mutex::scoped_lock lock(mJournalProtection);
+        LoadJournal(path);
+        mInjectQueuedEvents = injectQueuedEvents;
+        mDivergences = 0;
+        mFrame = 0;
+        mMode = Mode_Replay;
+    }
+    LoadFrame();
+}
+
+void EventJournal::stop(){
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    if (mMode == Mode_Record){
+        WriteRecordHead(Kind_End);
+        mOut.close();
+    } else if (mMode == Mode_Replay){
+        mRecords.clear();
+        mFrameSDLEvents.clear();
+        mFrameQueuedEvents.clear();
+    }
+    mMode = Mode_Idle;
+}
+
+
+EventJournal::Mode EventJournal::mode(){
+    return mMode;
+}
+
+bool EventJournal::recording(){
+    return mMode == Mode_Record;
+}
+
+bool EventJournal::replaying(){
+    return mMode == Mode_Replay;
+}
+
+bool EventJournal::finished(){
+    return mMode == Mode_Replay && mFrame > mLastFrame;
+}
+
+unsigned int EventJournal::frame(){
+    return mFrame;
+}
+
+unsigned int EventJournal::divergences(){
+    return mDivergences;
+}
+
+
+void EventJournal::nextFrame(){
+    if (mMode != Mode_Idle){
+        mFrame++;
+        if (mMode == Mode_Replay){
+            LoadFrame();
+        }
+    }
+}
+
+
+void EventJournal::recordSDLEvent(const SDL_Event &event){
+    // Drop events carry a pointer to SDL owned memory, which means nothing once written out.
+    if (event.type == SDL_DROPFILE || event.type == SDL_DROPTEXT){
+        return;
+    }
+
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    if (mMode == Mode_Record){
+        const Uint8 *bytes = reinterpret_cast<const Uint8 *>(&event);
+        size_t count = sizeof(SDL_Event);
+        while (count > 0 && bytes[count-1] == 0){
+            count--;
+        }
+
+        WriteRecordHead(Kind_SDLEvent);
+        WriteVarint(count);
+        mOut.write(reinterpret_cast<const char *>(bytes), count);
+    }
+}
+
+void EventJournal::recordQueuedEvent(const std::string &eventName, const EventDict &eventDict){
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    if (mMode == Mode_Record){
+        // Serialize the entries first so the count only covers the values we actually know how to write.
+        std::vector<std::pair<std::string, const boost::any *> > entries;
+        for (EventDict::const_iterator item = eventDict.begin(); item != eventDict.end(); item++){
+            const std::type_info &t = item->second.type();
+            if (t == typeid(int) || t == typeid(unsigned int) || t == typeid(float) || t == typeid(double) ||
+                t == typeid(bool) || t == typeid(std::string)){
+                entries.push_back(std::make_pair(item->first, &item->second));
+            }
+        }
+
+        WriteRecordHead(Kind_QueuedEvent);
+        WriteString(eventName);
+        WriteVarint(entries.size());
+        for (size_t index = 0; index < entries.size(); index++){
+            WriteString(entries.at(index).first);
+            WriteValue(*entries.at(index).second);
+        }
+    }
+}
+
+
+void EventJournal::recordUpdateSteps(int steps){
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    if (mMode == Mode_Record && steps > 0){
+        WriteRecordHead(Kind_UpdateSteps);
+        WriteVarint(steps);
+    }
+}
+
+
+int EventJournal::replayUpdateSteps(){
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    if (mMode == Mode_Replay){
+        return mFrameUpdateSteps;
+    }
+    return 0;
+}
+
+bool EventJournal::replaySDLEvent(SDL_Event *event){
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    if (mMode == Mode_Replay && !mFrameSDLEvents.empty()){
+        *event = mFrameSDLEvents.front();
+        mFrameSDLEvents.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void EventJournal::verifyQueuedEvent(const std::string &eventName){
+    if (mMode != Mode_Replay || mInjectQueuedEvents){
+        return;
+    }
+
+    boost::mutex::scoped_lock lock(mJournalProtection);
+    if (mFrameQueuedEvents.empty() || mFrameQueuedEvents.front() != eventName){
+        mDivergences++;
+    } else {
+        mFrameQueuedEvents.pop_front();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+
+void EventJournal::WriteRecordHead(Uint8 kind){
+    mOut.put(static_cast<char>(kind));
+    WriteVarint(mFrame - mLastWrittenFrame);
+    mLastWrittenFrame = mFrame;
+}
+
+void EventJournal::WriteVarint(Uint64 value){
+    while (value >= 0x80){
+        mOut.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    mOut.put(static_cast<char>(value));
+}
+
+void EventJournal::WriteString(const std::string &str){
+    WriteVarint(str.size());
+    mOut.write(str.data(), str.size());
+}
+
+void EventJournal::WriteValue(const boost::any &value){
+    const std::type_info &t = value.type();
+    if (t == typeid(int)){
+        // Zigzag encoded so small negative numbers stay small.
+        Sint64 v = boost::any_cast<int>(value);
+        mOut.put(static_cast<char>(Tag_Int));
+        WriteVarint((static_cast<Uint64>(v) << 1) ^ static_cast<Uint64>(v >> 63));
+    } else if (t == typeid(unsigned int)){
+        mOut.put(static_cast<char>(Tag_UInt));
+        WriteVarint(boost::any_cast<unsigned int>(value));
+    } else if (t == typeid(float)){
+        float f = boost::any_cast<float>(value);
+        Uint32 bits;
+        memcpy(&bits, &f, sizeof(bits));
+        mOut.put(static_cast<char>(Tag_Float));
+        for (int i = 0; i < 4; i++){
+            mOut.put(static_cast<char>((bits >> (i*8)) & 0xFF));
+        }
+    } else if (t == typeid(double)){
+        double d = boost::any_cast<double>(value);
+        Uint64 bits;
+        memcpy(&bits, &d, sizeof(bits));
+        mOut.put(static_cast<char>(Tag_Double));
+        for (int i = 0; i < 8; i++){
+            mOut.put(static_cast<char>((bits >> (i*8)) & 0xFF));
+        }
+    } else if (t == typeid(bool)){
+        mOut.put(static_cast<char>(Tag_Bool));
+        mOut.put(boost::any_cast<bool>(value) ? 1 : 0);
+    } else if (t == typeid(std::string)){
+        mOut.put(static_cast<char>(Tag_String));
+        WriteString(boost::any_cast<std::string>(value));
+    }
+}
+
+
+void EventJournal::LoadJournal(const std::string &path){
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if (!in){
+        throw std::runtime_error(std::string("Failed to open event journal \"") + path + std::string("\"."));
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string buf = ss.str();
+
+    size_t pos = 0;
+    if (buf.size() < 6 || buf.compare(0, 4, MAGIC, 4) != 0){
+        throw std::runtime_error("File is not an event journal.");
+    }
+    pos = 4;
+    if (ReadByte(buf, pos) != VERSION){
+        throw std::runtime_error("Unsupported event journal version.");
+    }
+    if (ReadByte(buf, pos) != sizeof(SDL_Event)){
+        throw std::runtime_error("Event journal was recorded with an incompatible SDL version.");
+    }
+
+    mRecords.clear();
+    mRecordIndex = 0;
+    mLastFrame = 0;
+
+    unsigned int frame = 0;
+    bool ended = false;
+    while (pos < buf.size() && !ended){
+        sJournalRecord rec;
+        rec.steps = 0;
+        rec.kind = ReadByte(buf, pos);
+        frame += static_cast<unsigned int>(ReadVarint(buf, pos));
+        rec.frame = frame;
+
+        switch (rec.kind){
+        case Kind_SDLEvent:
+            {
+                size_t count = static_cast<size_t>(ReadVarint(buf, pos));
+                if (count > sizeof(SDL_Event) || count > buf.size() - pos){
+                    throw std::runtime_error("Malformed SDL event in event journal.");
+                }
+                memset(&rec.event, 0, sizeof(SDL_Event));
+                memcpy(&rec.event, buf.data() + pos, count);
+                pos += count;
+                break;
+            }
+        case Kind_QueuedEvent:
+            {
+                rec.eventName = ReadString(buf, pos);
+                Uint64 entries = ReadVarint(buf, pos);
+                for (Uint64 i = 0; i < entries; i++){
+                    std::string key = ReadString(buf, pos);
+                    Uint8 tag = ReadByte(buf, pos);
+                    switch (tag){
+                    case Tag_Int:
+                        {
+                            Uint64 z = ReadVarint(buf, pos);
+                            rec.eventDict[key] = static_cast<int>(static_cast<Sint64>(z >> 1) ^ -static_cast<Sint64>(z & 1));
+                            break;
+                        }
+                    case Tag_UInt:
+                        rec.eventDict[key] = static_cast<unsigned int>(ReadVarint(buf, pos));
+                        break;
+                    case Tag_Float:
+                        {
+                            Uint32 bits = static_cast<Uint32>(ReadFixed(buf, pos, 4));
+                            float f;
+                            memcpy(&f, &bits, sizeof(f));
+                            rec.eventDict[key] = f;
+                            break;
+                        }
+                    case Tag_Double:
+                        {
+                            Uint64 bits = ReadFixed(buf, pos, 8);
+                            double d;
+                            memcpy(&d, &bits, sizeof(d));
+                            rec.eventDict[key] = d;
+                            break;
+                        }
+                    case Tag_Bool:
+                        rec.eventDict[key] = (ReadByte(buf, pos) != 0);
+                        break;
+                    case Tag_String:
+                        rec.eventDict[key] = ReadString(buf, pos);
+                        break;
+                    default:
+                        throw std::runtime_error("Unknown value type in event journal.");
+                    }
+                }
+                break;
+            }
+        case Kind_UpdateSteps:
+            rec.steps = static_cast<int>(ReadVarint(buf, pos));
+            break;
+        case Kind_End:
+            ended = true;
+            break;
+        default:
+            throw std::runtime_error("Unknown record in event journal.");
+        }
+
+        mLastFrame = frame;
+        if (rec.kind != Kind_End){
+            mRecords.push_back(rec);
+        }
+    }
+}
+
+void EventJournal::LoadFrame(){
+    RecordList inject;
+    {
+        boost::mutex::scoped_lock lock(mJournalProtection);
+        // Anything the game didn't queue on the previous frame is a divergence too.
+        mDivergences += mFrameQueuedEvents.size();
+        mFrameQueuedEvents.clear();
+        mFrameSDLEvents.clear();
+        mFrameUpdateSteps = 0;
+
+        while (mRecordIndex < mRecords.size() && mRecords.at(mRecordIndex).frame <= mFrame){
+            sJournalRecord &rec = mRecords.at(mRecordIndex);
+            if (rec.kind == Kind_SDLEvent){
+                mFrameSDLEvents.push_back(rec.event);
+            } else if (rec.kind == Kind_UpdateSteps){
+                mFrameUpdateSteps = rec.steps;
+            } else if (mInjectQueuedEvents){
+                inject.push_back(rec);
+            } else {
+                mFrameQueuedEvents.push_back(rec.eventName);
+            }
+            mRecordIndex++;
+        }
+    }
+
+    // Queued outside of the lock, as the EventManager calls back into the journal.
+    if (!inject.empty()){
+        EventManagerPtr em = EventManager::getInstance();
+        for (size_t index = 0; index < inject.size(); index++){
+            em->QueueEvent(inject.at(index).eventName, inject.at(index).eventDict);
+        }
+    }
+}
+
+
+} // End namespace "engine"
@@ -0,0 +1,196 @@
+#ifndef EVENTJOURNAL_H
+#define EVENTJOURNAL_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+
+#include <boost/any.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <SDL2/SDL.h>
+
+#include "EventManager.h"
+
+namespace engine{
+
+class EventJournal;
+/** \typedef
+* \brief std::shared_ptr<EventJournal>
+*/
+typedef std::shared_ptr<EventJournal> EventJournalPtr;
+
+/** \class
+* \brief [SINGLETON] Records and replays the input of a session, frame by frame.
+*
+* While recording, every SDL event polled by the GameStateManager and every event queued through the EventManager is
+* written to a compact binary journal, tagged with the frame number it occured on.
+* While replaying, the GameStateManager pulls its SDL events from the journal instead of from SDL, so the exact same input
+* is delivered on the exact same frames regardless of how fast those frames run. This makes repeatable, unattended
+* performance runs possible.
+*
+* Journal layout (all integers are little endian varints unless noted):
+*   Header  : "SFEJ" (4 bytes), version (1 byte), sizeof(SDL_Event) (1 byte)
+*   Record  : kind (1 byte), frame delta, payload
+*     Kind_SDLEvent   : byte count, raw SDL_Event bytes (trailing zero bytes are trimmed)
+*     Kind_QueuedEvent: event name, entry count, [key, type tag (1 byte), value] * entry count
+*     Kind_UpdateSteps: number of fixed timestep updates run on the frame (only written when non-zero)
+*     Kind_End        : no payload. Marks the last frame of the recording.
+*
+* Only EventDict values of type int, unsigned int, float, double, bool and std::string can be journaled. Entries of any
+* other type are dropped from the record.
+*/
+class EventJournal
+{
+    public:
+        enum Mode {Mode_Idle, Mode_Record, Mode_Replay};
+
+        ~EventJournal();
+
+        /**
+        * Opens the given file and begins recording to it. Any recording or replay already in progress is stopped first.
+        * Throws a runtime_error if the file cannot be opened for writing.
+        */
+        void startRecording(const std::string &path);
+
+        /**
+        * Loads the given journal and begins replaying it from frame zero. Any recording or replay already in progress is
+        * stopped first. Throws a runtime_error if the file cannot be read or is not a valid journal.
+        *
+        * @param path - The journal file to replay.
+        * @param injectQueuedEvents - If true, journaled EventManager events are queued again on their frame. If false
+        * (default), they are only compared against the events the game queues itself, and mismatches are counted as
+        * divergences.
+        */
+        void startReplay(const std::string &path, bool injectQueuedEvents=false);
+
+        /**
+        * Stops the active recording (writing the end marker) or replay.
+        */
+        void stop();
+
+        Mode mode();
+        bool recording();
+        bool replaying();
+
+        /**
+        * Returns true once a replay has delivered every frame contained in the journal.
+        */
+        bool finished();
+
+        /**
+        * Advances the journal to the next frame. Called by the GameStateManager at the top of each poll.
+        */
+        void nextFrame();
+        unsigned int frame();
+
+        /**
+        * Returns the number of queued events that did not match the journal during a replay.
+        */
+        unsigned int divergences();
+
+        void recordSDLEvent(const SDL_Event &event);
+        void recordQueuedEvent(const std::string &eventName, const EventDict &eventDict);
+        void recordUpdateSteps(int steps);
+
+        /**
+        * Pops the next journaled SDL event for the current frame into event. Returns false when the frame has no more events.
+        */
+        bool replaySDLEvent(SDL_Event *event);
+
+        /**
+        * Returns the number of fixed timestep updates that ran on the current frame when it was recorded.
+        */
+        int replayUpdateSteps();
+
+        /**
+        * Called by the EventManager whenever the game queues an event during a replay.
+        */
+        void verifyQueuedEvent(const std::string &eventName);
+
+        /**
+        * Configures SDL to use the dummy video driver and the software renderer so journals can be replayed without a
+        * display. Must be called before the first window is created.
+        */
+        static void UseHeadlessVideo();
+
+        static EventJournalPtr getInstance();
+
+    private:
+        enum RecordKind {Kind_SDLEvent=1, Kind_QueuedEvent=2, Kind_End=3, Kind_UpdateSteps=4};
+        enum ValueTag {Tag_Int=1, Tag_UInt=2, Tag_Float=3, Tag_Double=4, Tag_Bool=5, Tag_String=6};
+
+        static const char MAGIC[4];
+        static const Uint8 VERSION;
+
+        struct sJournalRecord{
+            Uint8 kind;
+            unsigned int frame;
+            SDL_Event event;
+            std::string eventName;
+            EventDict eventDict;
+            int steps;
+        };
+        typedef std::vector<sJournalRecord> RecordList;
+
+        static EventJournalPtr mInstance;
+
+        Mode mMode;
+        unsigned int mFrame;
+        unsigned int mLastWrittenFrame;
+        unsigned int mLastFrame;
+        unsigned int mDivergences;
+        bool mInjectQueuedEvents;
+
+        std::ofstream mOut;
+
+        RecordList mRecords;
+        size_t mRecordIndex;
+        std::deque<SDL_Event> mFrameSDLEvents;
+        std::deque<std::string> mFrameQueuedEvents;
+        int mFrameUpdateSteps;
+
+        // QueueEvent can be called from any thread, so writes are serialized.
+        boost::mutex mJournalProtection;
+
+        EventJournal();
+
+        void WriteRecordHead(Uint8 kind);
+        void WriteVarint(Uint64 value);
+        void WriteString(const std::string &str);
+        void WriteValue(const boost::any &value);
+
+        void LoadJournal(const std::string &path);
+        void LoadFrame();
+};
+
+
+} // End namespace "engine"
+
+#endif // EVENTJOURNAL_H
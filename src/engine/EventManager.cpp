@@ -23,6 +23,9 @@
 */
 
 #include "EventManager.h"
+#include "EventJournal.h"
+
+#include <iostream>
 
 namespace engine{
 
@@ -43,44 +46,127 @@ void EventManager::QueueEvent(const std::string eventName, const EventDict &even
     // First, check if a signal exists for this event.
     EventSignalMap::iterator iterFind = mEventSignalMap.find(eventName);
     if (iterFind != mEventSignalMap.end()){
-        EventSignal &sig = *iterFind->second;
-
         // One thread at a time!
         {
             boost::recursive_mutex::scoped_lock lock(mManagerProtection);
-            mNotificationQueue.push_back(NamedNotification(eventName, boost::bind(boost::ref(sig), eventDict)));
+
+            sQueuePolicy policy;
+            policy.flags = Policy_Default;
+            QueuePolicyMap::iterator iterPolicy = mQueuePolicies.find(eventName);
+            if (iterPolicy != mQueuePolicies.end()){
+                policy = iterPolicy->second;
+            }
+            NotificationVector &queue = (policy.flags & Policy_Priority) ? mPriorityQueue : mNotificationQueue;
+
+            bool stored = false;
+            if (policy.flags & (Policy_Coalesce | Policy_Accumulate)){
+                PendingSlotMap::iterator iterSlot = mPendingSlots.find(eventName);
+                if (iterSlot != mPendingSlots.end()){
+                    EventDict &pending = queue.at(iterSlot->second).eventDict;
+                    if (policy.flags & Policy_Accumulate){
+                        if (policy.fnAccumulate){
+                            policy.fnAccumulate(pending, eventDict);
+                        } else {
+                            MergeEventDicts(pending, eventDict);
+                        }
+                    } else {
+                        pending = eventDict;
+                    }
+                    stored = true;
+                } else {
+                    mPendingSlots[eventName] = queue.size();
+                }
+            }
+
+            if (!stored){
+                sQueuedEvent qe;
+                qe.eventName = eventName;
+                qe.eventDict = eventDict;
+                qe.signal = iterFind->second;
+                queue.push_back(qe);
+            }
+        }
+
+        // Let the journal see the event if a recording or replay is running.
+        EventJournalPtr journal = EventJournal::getInstance();
+        if (journal->recording()){
+            journal->recordQueuedEvent(eventName, eventDict);
+        } else if (journal->replaying()){
+            journal->verifyQueuedEvent(eventName);
         }
     }
 }
 
 
 void EventManager::FlushQueue(){
-    // Will hold a copy of all existing notifications within the main vector.
+    // Will hold a copy of all existing notifications within the main vectors.
+    NotificationVector vPriority;
     NotificationVector vNotifications;
 
     // Open a protected scope to modify the notification list.
     {
         // Lock for only one thread at a time.
         boost::recursive_mutex::scoped_lock lock(mManagerProtection);
-        // Move the main notification vector to the local vector. This will effectively clear the main notification
-        // vector.
+        // Move the notification vectors to the local vectors. This will effectively clear the main notification
+        // vectors. Pending slots point into the vectors we just took, so they go too.
+        std::swap(vPriority, mPriorityQueue);
         std::swap(vNotifications, mNotificationQueue);
+        mPendingSlots.clear();
     }
-    // Out of the locked scope, and therefore the mNotificationQueue can continue storing new events, even if we're
+    // Out of the locked scope, and therefore the queues can continue storing new events, even if we're
     // still processing this batch.
 
-    BOOST_FOREACH(const NamedNotification &i, vNotifications){
-    //for (NotificationVector::iterator i = vNotifications.begin(); i != vNotifications.end(); i++){
-        // Debugging output
-        std::cout << "Flushing " << i.first << std::endl;
+    NotificationVector* lanes[2] = {&vPriority, &vNotifications};
+    for (int lane = 0; lane < 2; lane++){
+        BOOST_FOREACH(const sQueuedEvent &i, *lanes[lane]){
+            try{
+                (*i.signal)(i.eventDict);
+            } catch (const boost::bad_any_cast &) {
+                std::cout << "*** Invalid any_cast in \"" << i.eventName << "\" ***" << std::endl;
+            }
+        }
+    }
+    // The local vectors will now go out of scope and therefore clear all of the old queued events.
+}
+
+
+void EventManager::SetQueuePolicy(const std::string &eventName, unsigned int policy, const AccumulateFunction &fnAccumulate){
+    boost::recursive_mutex::scoped_lock lock(mManagerProtection);
+    // A pending instance may be sitting in the other lane, so the next one starts a fresh slot.
+    mPendingSlots.erase(eventName);
+    if (policy == Policy_Default){
+        mQueuePolicies.erase(eventName);
+    } else {
+        sQueuePolicy &p = mQueuePolicies[eventName];
+        p.flags = policy;
+        p.fnAccumulate = fnAccumulate;
+    }
+}
+
+
+void EventManager::MergeEventDicts(EventDict &pending, const EventDict &incoming){
+    for (EventDict::const_iterator item = incoming.begin(); item != incoming.end(); item++){
+        EventDict::iterator target = pending.find(item->first);
+        if (target == pending.end()){
+            pending.insert(*item);
+            continue;
+        }
 
-        try{
-            i.second();
-        } catch (const boost::bad_any_cast &) {
-            std::cout << "*** Invalid any_cast ***" << std::endl;
+        const std::type_info &t = item->second.type();
+        if (t != target->second.type()){
+            target->second = item->second;
+        } else if (t == typeid(int)){
+            target->second = boost::any_cast<int>(target->second) + boost::any_cast<int>(item->second);
+        } else if (t == typeid(unsigned int)){
+            target->second = boost::any_cast<unsigned int>(target->second) + boost::any_cast<unsigned int>(item->second);
+        } else if (t == typeid(float)){
+            target->second = boost::any_cast<float>(target->second) + boost::any_cast<float>(item->second);
+        } else if (t == typeid(double)){
+            target->second = boost::any_cast<double>(target->second) + boost::any_cast<double>(item->second);
+        } else {
+            target->second = item->second;
         }
     }
-    // vNotifications will now go out of scope and therefore clear all of the old queued events.
 }
 
 
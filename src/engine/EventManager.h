@@ -88,6 +88,38 @@ class EventManager{
         */
         void QueueEvent(const std::string eventName, const EventDict &eventDict);
 
+        /** \enum
+        * \brief Flags controlling how QueueEvent stores events of a given name. Flags may be combined with |.
+        */
+        enum QueuePolicy {
+            Policy_Default = 0,     /**< Every queued instance is stored and delivered in order. */
+            Policy_Coalesce = 1,    /**< Only the latest instance queued since the last flush is delivered. */
+            Policy_Accumulate = 2,  /**< Instances queued since the last flush are merged into one EventDict. */
+            Policy_Priority = 4     /**< Delivered ahead of all events without this flag on the next flush. */
+        };
+
+        /** \typedef A void(EventDict &pending, const EventDict &incoming) function signature */
+        typedef void AccumulateFuncSignature(EventDict &, const EventDict &);
+        /** \typedef boost::function<AccumulateFuncSignature> */
+        typedef boost::function<AccumulateFuncSignature> AccumulateFunction;
+
+        /**
+        * Sets the queue policy for the given event name. Events already waiting in the queue are not affected.
+        * This method is thread-safe.
+        *
+        * @param eventName - [const] The string name of the event the policy applies to.
+        * @param policy - A combination of QueuePolicy flags.
+        * @param fnAccumulate - [const] Used with Policy_Accumulate to merge an incoming EventDict into the pending one.
+        * If empty, MergeEventDicts is used.
+        */
+        void SetQueuePolicy(const std::string &eventName, unsigned int policy, const AccumulateFunction &fnAccumulate=AccumulateFunction());
+
+        /**
+        * The default accumulator. Numeric values (int, unsigned int, float, double) found in both dicts are summed, any
+        * other value is replaced by the incoming one.
+        */
+        static void MergeEventDicts(EventDict &pending, const EventDict &incoming);
+
         /**
         * Flushes the event queue by passing all stored EventDict objects to their requested event handlers.
         * This method is thread-safe.
@@ -117,18 +149,36 @@ class EventManager{
     private:
         static EventManagerPtr mInstance;
 
-        typedef std::pair<std::string, EventNotificationFunction> NamedNotification;
-        typedef std::vector<NamedNotification> NotificationVector;
-        NotificationVector mNotificationQueue;
-
-        // Mutex used to ensure one-at-a-time access if needed.
-        boost::recursive_mutex mManagerProtection;
-
         typedef boost::signals2::signal<SignalSignature> EventSignal;
         typedef std::shared_ptr<EventSignal> EventSignalPtr;
         typedef std::map<std::string, EventSignalPtr> EventSignalMap;
         EventSignalMap mEventSignalMap;
 
+        // The EventDict is held (rather than bound into the call) so coalescing and accumulating policies can rewrite it
+        // while it waits.
+        struct sQueuedEvent{
+            std::string eventName;
+            EventDict eventDict;
+            EventSignalPtr signal;
+        };
+        typedef std::vector<sQueuedEvent> NotificationVector;
+        NotificationVector mNotificationQueue;
+        NotificationVector mPriorityQueue;
+
+        struct sQueuePolicy{
+            unsigned int flags;
+            AccumulateFunction fnAccumulate;
+        };
+        typedef std::map<std::string, sQueuePolicy> QueuePolicyMap;
+        QueuePolicyMap mQueuePolicies;
+
+        // Where a coalesced or accumulated event currently sits in its queue, so repeats are found without a scan.
+        typedef std::map<std::string, size_t> PendingSlotMap;
+        PendingSlotMap mPendingSlots;
+
+        // Mutex used to ensure one-at-a-time access if needed.
+        boost::recursive_mutex mManagerProtection;
+
         // Constructor.
         EventManager();
 };
@@ -23,23 +23,41 @@
 */
 
 #include "GameStateManager.h"
+#include "EventJournal.h"
+#include "Profiler.h"
 
 
 namespace engine{
 
 
 
-GameStateManager::GameStateManager(){}
+GameStateManager::GameStateManager() : mChanged(true), mParallelUpdate(true), mSnapshotUpdateables(0), mSimSteps(0), mSimBusy(false), mSimStopping(false){}
 
 GameStateManager::~GameStateManager()
 {
+    try{
+        finishUpdate();
+    } catch (...) {
+        // Too late to do anything about a failed update now.
+    }
     clear();
+    if (mSimThread.joinable()){
+        {
+            boost::mutex::scoped_lock lock(mSimProtection);
+            mSimStopping = true;
+        }
+        mSimWake.notify_all();
+        mSimThread.join();
+    }
 }
 
 
 void GameStateManager::addState(StatePtr s){
+    GuardRegistered(s);
+    GuardStateChange();
+    WaitForPrepared(s);
     StatePtr cstate = currentState();
-    if (cstate.get() != 0){
+    if (cstate.get() != 0 && !s->isOverlay()){
         cstate->looseFocus();
     }
     mStateStack.push_back(s);
@@ -48,6 +66,7 @@ void GameStateManager::addState(StatePtr s){
 }
 
 void GameStateManager::swapState(StatePtr s){
+    GuardRegistered(s);
     if (!mStateStack.empty()){
         dropState();
     }
@@ -55,17 +74,57 @@ void GameStateManager::swapState(StatePtr s){
 }
 
 void GameStateManager::elevateState(StatePtr s){
-    RemoveFromStack(s); // If s is not already on the stack, this does nothing.
-    RebuildStateTypes();
+    GuardRegistered(s);
+    GuardStateChange();
+    if (RemoveFromStack(s)){ // If s is not already on the stack, this does nothing.
+        DropStateType(s.get());
+    }
     addState(s);
 }
 
 void GameStateManager::dropState(){
+    GuardStateChange();
     if (!mStateStack.empty()){
-        mStateStack.at(mStateStack.size()-1)->stop();
-        DropStateType(mStateStack.at(mStateStack.size()-1).get());
+        StatePtr s = mStateStack.at(mStateStack.size()-1);
+        s->stop();
+        DropStateType(s.get());
         mStateStack.pop_back();
+
+        if (!s->isOverlay() && !mStateStack.empty()){
+            mStateStack.at(mStateStack.size()-1)->getFocus();
+        }
+    }
+}
+
+void GameStateManager::preloadState(StatePtr s){
+    if (s.get() == 0 || FindPreload(s.get()).get() != 0){
+        return;
+    }
+    GuardRegistered(s);
+    PreloadPtr preload(new sPreload());
+    preload->state = s;
+    preload->done = false;
+    mPreloads.push_back(preload);
+    JobPool::getInstance()->submit(boost::bind(&GameStateManager::PrepareState, preload));
+}
+
+bool GameStateManager::isPrepared(StatePtr s){
+    PreloadPtr preload = FindPreload(s.get());
+    if (preload.get() != 0){
+        boost::mutex::scoped_lock lock(preload->protection);
+        return preload->done;
     }
+    return true;
+}
+
+void GameStateManager::addStateWhenPrepared(StatePtr s){
+    preloadState(s);
+    mPendingTransitions.push_back(PendingTransition(Transition_Add, FindPreload(s.get())));
+}
+
+void GameStateManager::swapStateWhenPrepared(StatePtr s){
+    preloadState(s);
+    mPendingTransitions.push_back(PendingTransition(Transition_Swap, FindPreload(s.get())));
 }
 
 StatePtr GameStateManager::currentState(){
@@ -92,30 +151,302 @@ unsigned int GameStateManager::size(){
 }
 
 
+void GameStateManager::setParallelUpdate(bool enable){
+    mParallelUpdate = enable;
+}
+
 void GameStateManager::update(){
+    ENGINE_PROFILE_ZONE("GameStateManager::update");
+    if (!mParallelUpdate){
+        for (size_t index = 0; index < mUpdateables.size(); index ++){
+            mUpdateables.at(index)->update();
+        }
+        return;
+    }
+
+    // Updates are grouped into waves of parallel-safe updateables with no conflicting dependency tags. Anything that isn't
+    // parallel-safe, or conflicts with the wave being built, waits for that wave to finish, which keeps stack order for
+    // every update that could observe it.
+    unsigned int waveReads = 0;
+    unsigned int waveWrites = 0;
     for (size_t index = 0; index < mUpdateables.size(); index ++){
-        mUpdateables.at(index)->update();
+        IUpdateable *u = mUpdateables.at(index);
+        if (!u->parallelUpdate()){
+            FlushUpdateWave();
+            waveReads = waveWrites = 0;
+            u->update();
+            continue;
+        }
+
+        unsigned int reads = u->updateReads();
+        unsigned int writes = u->updateWrites();
+        if ((writes & (waveReads | waveWrites)) != 0 || (reads & waveWrites) != 0){
+            FlushUpdateWave();
+            waveReads = waveWrites = 0;
+        }
+        mUpdateWave.push_back(boost::bind(&IUpdateable::update, u));
+        waveReads |= reads;
+        waveWrites |= writes;
     }
+    // This is the barrier before render(). Nothing is left running once update() returns.
+    FlushUpdateWave();
 }
 
 void GameStateManager::render(){
+    ENGINE_PROFILE_ZONE("GameStateManager::render");
+    mChanged = false;
     for (size_t index = 0; index < mRenderables.size(); index++){
         mRenderables.at(index)->render();
     }
 }
 
+void GameStateManager::renderInterpolated(float alpha){
+    ENGINE_PROFILE_ZONE("GameStateManager::renderInterpolated");
+    mChanged = false;
+    for (size_t index = 0; index < mRenderables.size(); index++){
+        mRenderables.at(index)->renderInterpolated(alpha);
+    }
+}
+
+unsigned int GameStateManager::idleUntil(){
+    if (!mPendingTransitions.empty()){
+        return 0;
+    }
+    unsigned int until = IState::IDLE_FOREVER;
+    for (size_t index = 0; index < mStateStack.size(); index++){
+        unsigned int u = mStateStack.at(index)->idleUntil();
+        if (u < until){
+            until = u;
+        }
+    }
+    return until;
+}
+
+bool GameStateManager::waitForActivity(){
+    unsigned int until = idleUntil();
+    Uint32 now = SDL_GetTicks();
+    if (until == 0 || until <= now || mChanged){
+        return false;
+    }
+
+    // Capped so queued transitions and other work outside of SDL's event queue is never left waiting for long.
+    Uint32 timeout = until - now;
+    if (timeout > MAX_IDLE_WAIT){
+        timeout = MAX_IDLE_WAIT;
+    }
+    ENGINE_PROFILE_ZONE("GameStateManager::waitForActivity");
+    SDL_WaitEventTimeout(nullptr, static_cast<int>(timeout));
+    return true;
+}
+
+bool GameStateManager::changed(){
+    return mChanged;
+}
+
+bool GameStateManager::pipelineReady(){
+    return !mUpdateables.empty() && mSnapshotUpdateables == mUpdateables.size();
+}
+
+void GameStateManager::snapshot(){
+    finishUpdate();
+    for (size_t index = 0; index < mSnapshots.size(); index++){
+        mSnapshots.at(index)->snapshot();
+    }
+}
+
+void GameStateManager::beginUpdate(int steps){
+    if (steps <= 0){
+        return;
+    }
+    finishUpdate();
+
+    if (!mSimThread.joinable()){
+        mSimThread = boost::thread(boost::bind(&GameStateManager::SimulationLoop, this));
+    }
+    {
+        boost::mutex::scoped_lock lock(mSimProtection);
+        mSimSteps = steps;
+        mSimBusy = true;
+    }
+    mSimWake.notify_one();
+}
+
+void GameStateManager::finishUpdate(){
+    boost::mutex::scoped_lock lock(mSimProtection);
+    while (mSimBusy){
+        mSimDone.wait(lock);
+    }
+    if (mSimError){
+        std::exception_ptr error = mSimError;
+        mSimError = std::exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
 void GameStateManager::poll(){
+    ENGINE_PROFILE_ZONE("GameStateManager::poll");
+    ApplyPreparedTransitions();
+
+    EventJournalPtr journal = EventJournal::getInstance();
+    journal->nextFrame();
+
     SDL_Event event;
-    while (SDL_PollEvent(&event)){
-        for (size_t index = 0; index < mIOStates.size(); index++){
-            if (mIOStates.at(index)->poll(event))
-                break; // If the states returns true on the poll call, then this event is handled. No need to loop through all states.
+    if (journal->replaying()){
+        // SDL's queue still has to be pumped, but during a replay the only input that counts is the journaled input.
+        while (SDL_PollEvent(&event)){}
+        while (journal->replaySDLEvent(&event)){
+            DispatchEvent(event);
+        }
+    } else {
+        while (SDL_PollEvent(&event)){
+            if (journal->recording()){
+                journal->recordSDLEvent(event);
+            }
+            DispatchEvent(event);
         }
     }
 }
 
 // -----------------------------------------------------------------------------
 
+void GameStateManager::SimulationLoop(){
+    while (true){
+        int steps = 0;
+        {
+            boost::mutex::scoped_lock lock(mSimProtection);
+            while (!mSimBusy && !mSimStopping){
+                mSimWake.wait(lock);
+            }
+            if (mSimStopping){
+                return;
+            }
+            steps = mSimSteps;
+        }
+
+        std::exception_ptr error;
+        try{
+            for (int i = 0; i < steps; i++){
+                update();
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            boost::mutex::scoped_lock lock(mSimProtection);
+            mSimError = error;
+            mSimBusy = false;
+        }
+        mSimDone.notify_all();
+    }
+}
+
+void GameStateManager::PrepareState(PreloadPtr preload){
+    ENGINE_PROFILE_ZONE("GameStateManager::PrepareState");
+    std::exception_ptr error;
+    try{
+        preload->state->prepare();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    {
+        boost::mutex::scoped_lock lock(preload->protection);
+        preload->error = error;
+        preload->done = true;
+    }
+    preload->finished.notify_all();
+}
+
+GameStateManager::PreloadPtr GameStateManager::FindPreload(IState* s){
+    for (size_t index = 0; index < mPreloads.size(); index++){
+        if (mPreloads.at(index)->state.get() == s){
+            return mPreloads.at(index);
+        }
+    }
+    return PreloadPtr();
+}
+
+void GameStateManager::WaitForPrepared(StatePtr &s){
+    PreloadPtr preload = FindPreload(s.get());
+    if (preload.get() == 0){
+        return;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(preload->protection);
+        while (!preload->done){
+            preload->finished.wait(lock);
+        }
+    }
+
+    for (size_t index = 0; index < mPreloads.size(); index++){
+        if (mPreloads.at(index) == preload){
+            mPreloads.erase(mPreloads.begin() + index);
+            break;
+        }
+    }
+    if (preload->error){
+        std::rethrow_exception(preload->error);
+    }
+}
+
+void GameStateManager::ApplyPreparedTransitions(){
+    while (!mPendingTransitions.empty()){
+        PendingTransition t = mPendingTransitions.front();
+        {
+            boost::mutex::scoped_lock lock(t.second->protection);
+            if (!t.second->done){
+                return; // Later transitions wait their turn.
+            }
+        }
+        mPendingTransitions.erase(mPendingTransitions.begin());
+
+        StatePtr s = t.second->state;
+        if (t.first == Transition_Swap){
+            swapState(s);
+        } else {
+            addState(s);
+        }
+    }
+}
+
+void GameStateManager::GuardStateChange(){
+    if (mSimThread.joinable() && boost::this_thread::get_id() == mSimThread.get_id()){
+        throw std::runtime_error("The state stack cannot be changed from a pipelined update.");
+    }
+    finishUpdate();
+}
+
+void GameStateManager::GuardRegistered(StatePtr &s){
+    if (s.get() != 0 && s->capabilities() == StateCap_Unregistered){
+        throw std::runtime_error("The state never called registerCapabilities, so it would never be updated, rendered or polled.");
+    }
+}
+
+void GameStateManager::FlushUpdateWave(){
+    try{
+        if (mUpdateWave.size() == 1){
+            // Not worth waking a worker for.
+            mUpdateWave.at(0)();
+        } else if (!mUpdateWave.empty()){
+            JobPool::getInstance()->runAndWait(mUpdateWave);
+        }
+    } catch (...) {
+        mUpdateWave.clear();
+        throw;
+    }
+    mUpdateWave.clear();
+}
+
+void GameStateManager::DispatchEvent(SDL_Event &event){
+    mChanged = true;
+    for (size_t index = 0; index < mIOStates.size(); index++){
+        if (mIOStates.at(index)->poll(event))
+            break; // If the states returns true on the poll call, then this event is handled. No need to loop through all states.
+    }
+}
+
 bool GameStateManager::RemoveFromStack(StatePtr &s){
     for (size_t index = 0; index < mStateStack.size(); index++){
         if (mStateStack.at(index).get() == s.get()){
@@ -127,48 +458,43 @@ bool GameStateManager::RemoveFromStack(StatePtr &s){
 }
 
 void GameStateManager::AddStateType(IState* state){
-    IRenderable *r = dynamic_cast<IRenderable *>(state);
-    if(r){
-        mRenderables.push_back(r);
+    mChanged = true;
+    // States are always added to the top of the stack, so appending keeps every list in stack order.
+    unsigned int caps = state->capabilities();
+    if (caps & StateCap_Renderable){
+        mRenderables.push_back(state->asRenderable());
     }
-
-    IUpdateable *u = dynamic_cast<IUpdateable *>(state);
-    if(u){
-        mUpdateables.push_back(u);
+    if (caps & StateCap_Updateable){
+        mUpdateables.push_back(state->asUpdateable());
     }
-
-    IIOState *i = dynamic_cast<IIOState *>(state);
-    if (i){
-        mIOStates.push_back(i);
+    if (caps & StateCap_IO){
+        mIOStates.push_back(state->asIOState());
+    }
+    if (caps & StateCap_RenderSnapshot){
+        mSnapshots.push_back(state->asRenderSnapshot());
+        if (caps & StateCap_Updateable){
+            mSnapshotUpdateables++;
+        }
     }
 }
 
 
 void GameStateManager::DropStateType(IState* state){
-    IRenderable *r = dynamic_cast<IRenderable *>(state);
-    if(r){
-        mRenderables.pop_back();
+    mChanged = true;
+    unsigned int caps = state->capabilities();
+    if (caps & StateCap_Renderable){
+        DropFromList(mRenderables, state->asRenderable());
     }
-
-    IUpdateable *u = dynamic_cast<IUpdateable *>(state);
-    if(u){
-        mUpdateables.pop_back();
+    if (caps & StateCap_Updateable){
+        DropFromList(mUpdateables, state->asUpdateable());
     }
-
-    IIOState *i = dynamic_cast<IIOState *>(state);
-    if (i){
-        mIOStates.pop_back();
+    if (caps & StateCap_IO){
+        DropFromList(mIOStates, state->asIOState());
     }
-}
-
-void GameStateManager::RebuildStateTypes(){
-    mRenderables.clear();
-    mUpdateables.clear();
-    mIOStates.clear();
-
-    if (!mStateStack.empty()){
-        for (size_t index = 0; index < mStateStack.size(); index++){
-            AddStateType(mStateStack.at(index).get());
+    if (caps & StateCap_RenderSnapshot){
+        DropFromList(mSnapshots, state->asRenderSnapshot());
+        if (caps & StateCap_Updateable){
+            mSnapshotUpdateables--;
         }
     }
 }
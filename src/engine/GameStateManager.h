@@ -31,10 +31,12 @@
 //#include <boost/weak_ptr.hpp>
 
 #include "Handler.h"
+#include "JobPool.h"
 #include "StateManager.h"
 #include "Updateables.h"
 #include "IOStates.h"
 #include "Renderables.h"
+#include "RenderSnapshot.h"
 #include "States.h"
 
 namespace engine{
@@ -52,6 +54,7 @@ class GameStateManager : public IStateManager, public IUpdateable, public IRende
         /**
         * Adds the given state to the head of the state stack. If other states exist, the current state is notified it is loosing focus and the given state is notified it now has
         & primary focus.
+        * Throws a runtime_error if the state never called registerCapabilities.
         */
         void addState(StatePtr s);
 
@@ -72,6 +75,24 @@ class GameStateManager : public IStateManager, public IUpdateable, public IRende
         */
         void dropState();
 
+        /**
+        * Starts the given state's prepare() on the engine JobPool and returns immediately. Does nothing if the state is already
+        * being, or has been, prepared. Adding a state whose prepare() is still running waits for it to finish.
+        */
+        void preloadState(StatePtr s);
+
+        /**
+        * Returns true once the state's prepare() has finished (or if it was never preloaded).
+        */
+        bool isPrepared(StatePtr s);
+
+        /**
+        * Preloads the given state and adds it (or swaps it for the current state) once it's prepared. The current state keeps
+        * running until then. The transition is applied at the top of poll(), on the main thread.
+        */
+        void addStateWhenPrepared(StatePtr s);
+        void swapStateWhenPrepared(StatePtr s);
+
         /**
         * Returns pointer to the current state on the state stack.
         */
@@ -92,17 +113,100 @@ class GameStateManager : public IStateManager, public IUpdateable, public IRende
         */
         unsigned int size();
 
+        /**
+        * Enables or disables running parallel-safe updateables on the engine JobPool. Enabled by default. When disabled, every
+        * updateable is updated on the calling thread in stack order.
+        */
+        void setParallelUpdate(bool enable);
+
         void poll();
         void update();
         void render();
+        void renderInterpolated(float alpha);
+
+        /**
+        * Returns the earliest idleUntil() of the states on the stack, or 0 (zero) if any state is animating or a prepared
+        * transition is waiting to be applied.
+        */
+        unsigned int idleUntil();
+
+        /**
+        * Blocks until an SDL event arrives or the states are due (see idleUntil), whichever is first. Returns true if it
+        * actually waited. Events are left on the SDL queue for poll().
+        */
+        bool waitForActivity();
+
+        /**
+        * Returns true if an event has been dispatched or the state stack has changed since the last render.
+        */
+        bool changed();
+
+        /**
+        * Returns true if every updateable state on the stack also implements IRenderSnapshot, meaning updates can run on the
+        * simulation thread while rendering.
+        */
+        bool pipelineReady();
+
+        /**
+        * Calls snapshot() on every IRenderSnapshot state. Waits for any running pipelined update first.
+        */
+        void snapshot();
+
+        /**
+        * Starts running the given number of update() calls on the simulation thread and returns immediately.
+        * Changing the state stack waits for the pipelined update to finish, and changing it from within a pipelined
+        * update() throws a runtime_error; queue an event instead.
+        */
+        void beginUpdate(int steps);
+
+        /**
+        * Waits for the update started by beginUpdate to finish. Rethrows anything the update threw.
+        */
+        void finishUpdate();
 
     private:
+        /** Longest single wait in waitForActivity, in milliseconds. */
+        static const Uint32 MAX_IDLE_WAIT = 250;
+
         typedef std::vector<StatePtr> StateVec;
         StateVec mStateStack;
+        bool mChanged;
+
+        struct sPreload{
+            StatePtr state;
+            bool done;
+            std::exception_ptr error;
+            boost::mutex protection;
+            boost::condition_variable finished;
+        };
+        typedef std::shared_ptr<sPreload> PreloadPtr;
+        typedef std::vector<PreloadPtr> PreloadVec;
+        PreloadVec mPreloads;
+
+        enum TransitionType {Transition_Add, Transition_Swap};
+        typedef std::pair<TransitionType, PreloadPtr> PendingTransition;
+        std::vector<PendingTransition> mPendingTransitions;
 
         typedef std::vector<IUpdateable *> UpdateableVec;
         UpdateableVec mUpdateables;
 
+        bool mParallelUpdate;
+        JobPool::JobList mUpdateWave;
+
+        typedef std::vector<IRenderSnapshot *> SnapshotVec;
+        SnapshotVec mSnapshots;
+        unsigned int mSnapshotUpdateables; // Number of states that are both IUpdateable and IRenderSnapshot.
+
+        // The simulation thread, started on the first pipelined update.
+        boost::thread mSimThread;
+        boost::mutex mSimProtection;
+        boost::condition_variable mSimWake;
+        boost::condition_variable mSimDone;
+        int mSimSteps;
+        bool mSimBusy;
+        bool mSimStopping;
+        std::exception_ptr mSimError;
+
         typedef std::vector<IRenderable *> RenderableVec;
         RenderableVec mRenderables;
 
@@ -115,9 +219,69 @@ class GameStateManager : public IStateManager, public IUpdateable, public IRende
         */
         bool RemoveFromStack(StatePtr &s);
 
+        /**
+        * Passes the event down the IIOState list until one of them reports it as handled.
+        */
+        void DispatchEvent(SDL_Event &event);
+
+        /**
+        * Runs and clears the current wave of parallel updates. Returns once every update in the wave has finished.
+        */
+        void FlushUpdateWave();
+
+        void SimulationLoop();
+
+        /**
+        * Runs on a worker thread. Calls prepare() on the preloading state and marks it done.
+        */
+        static void PrepareState(PreloadPtr preload);
+
+        PreloadPtr FindPreload(IState* s);
+
+        /**
+        * If the state is being preloaded, waits for prepare() to finish, rethrows anything it threw and forgets the preload.
+        */
+        void WaitForPrepared(StatePtr &s);
+
+        /**
+        * Applies queued transitions whose states have finished preparing, in the order they were queued.
+        */
+        void ApplyPreparedTransitions();
+
+        /**
+        * Called before any change to the state stack. Waits for a pipelined update, or throws if called from within one.
+        */
+        void GuardStateChange();
+
+        /**
+        * Throws a runtime_error if the state never called registerCapabilities. Called before a state is added or preloaded.
+        */
+        void GuardRegistered(StatePtr &s);
+
+        /**
+        * Adds the state's registered interfaces to the dispatch lists. The state must be the new top of the stack.
+        */
         void AddStateType(IState* state);
+
+        /**
+        * Removes the state's registered interfaces from the dispatch lists. O(1) when the state is the top of the stack.
+        */
         void DropStateType(IState* state);
-        void RebuildStateTypes();
+
+        template<typename T>
+        static void DropFromList(std::vector<T*> &list, T* item){
+            // The dropped state is almost always the top of the stack, and so the last entry.
+            if (!list.empty() && list.back() == item){
+                list.pop_back();
+                return;
+            }
+            for (size_t index = list.size(); index > 0; index--){
+                if (list.at(index-1) == item){
+                    list.erase(list.begin() + (index-1));
+                    return;
+                }
+            }
+        }
 };
 
 } // End namespace "engine"
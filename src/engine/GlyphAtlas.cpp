@@ -0,0 +1,203 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "GlyphAtlas.h"
+#include "Utf8.h"
+#include "Profiler.h"
+
+#include <cstring>
+#include <algorithm>
+
+// Before 2.0.18, SDL_ttf only takes 16 bit characters.
+#ifdef SDL_TTF_VERSION_ATLEAST
+    #if SDL_TTF_VERSION_ATLEAST(2, 0, 18)
+        #define GLYPHATLAS_32BIT_GLYPHS
+    #endif
+#endif
+
+
+namespace engine{
+
+
+GlyphAtlas::GlyphAtlas(TTF_Font* font, WindowHnd win, int pageSize) : mFont(font), mWindow(win), mPageSize(pageSize){
+    mKerning = TTF_GetFontKerning(font) != 0;
+    for (Uint32 i = 0; i < DIRECT_GLYPHS; i++){
+        mDirectReady[i] = false;
+    }
+}
+
+const GlyphAtlas::sGlyph* GlyphAtlas::glyph(Uint32 ch){
+    if (ch < DIRECT_GLYPHS){
+        if (!mDirectReady[ch]){
+            Rasterize(ch, mDirect[ch]);
+            mDirectReady[ch] = true;
+        }
+        return &mDirect[ch];
+    }
+    std::unordered_map<Uint32, sGlyph>::iterator item = mGlyphs.find(ch);
+    if (item == mGlyphs.end()){
+        sGlyph g;
+        Rasterize(ch, g);
+        item = mGlyphs.insert(std::pair<Uint32, sGlyph>(ch, g)).first;
+    }
+    return &item->second;
+}
+
+int GlyphAtlas::kerning(Uint32 previous, Uint32 ch){
+    if (!mKerning){
+        return 0;
+    }
+#ifdef GLYPHATLAS_32BIT_GLYPHS
+    return TTF_GetFontKerningSizeGlyphs32(mFont, previous, ch);
+#else
+    return TTF_GetFontKerningSizeGlyphs(mFont, static_cast<Uint16>(previous), static_cast<Uint16>(ch));
+#endif
+}
+
+const GlyphAtlas::sRun& GlyphAtlas::shape(const std::string &text){
+    std::unordered_map<std::string, sRun>::iterator item = mRuns.find(text);
+    if (item != mRuns.end()){
+        return item->second;
+    }
+
+    ENGINE_PROFILE_ZONE("GlyphAtlas::shape");
+    if (mRuns.size() >= MAX_CACHED_RUNS){
+        mRuns.clear();
+    }
+    sRun &run = mRuns[text];
+    Utf8::Decode(text, mDecoded);
+    int penX = 0;
+    Uint32 previous = 0;
+    for (size_t i = 0; i < mDecoded.size(); i++){
+        Uint32 ch = mDecoded[i];
+        const sGlyph* g = glyph(ch);
+        if (previous != 0){
+            penX += kerning(previous, ch);
+        }
+        if (g->texture != nullptr){
+            sPlacedGlyph placed = {g, penX};
+            run.glyphs.push_back(placed);
+        }
+        penX += g->advance;
+        previous = ch;
+    }
+    run.width = penX;
+    return run;
+}
+
+int GlyphAtlas::draw(const std::string &text, int x, int y, const SDL_Color &color){
+    const sRun &run = shape(text);
+    for (size_t i = 0; i < run.glyphs.size(); i++){
+        const sGlyph* g = run.glyphs[i].glyph;
+        SDL_Rect dst = {x + run.glyphs[i].x, y, g->rect.w, g->rect.h};
+        mWindow->batch(g->texture, &g->rect, &dst, 0.0, nullptr, SDL_FLIP_NONE, &color);
+    }
+    return run.width;
+}
+
+int GlyphAtlas::measure(const std::string &text){
+    return shape(text).width;
+}
+
+
+// PRIVATE
+
+void GlyphAtlas::Rasterize(Uint32 ch, sGlyph &glyph){
+    ENGINE_PROFILE_ZONE("GlyphAtlas::Rasterize");
+    glyph.texture = nullptr;
+    glyph.rect.x = glyph.rect.y = glyph.rect.w = glyph.rect.h = 0;
+    glyph.advance = 0;
+
+    int minx = 0, maxx = 0, miny = 0, maxy = 0;
+    SDL_Surface* surf = nullptr;
+    SDL_Color white = {255, 255, 255, 255};
+#ifdef GLYPHATLAS_32BIT_GLYPHS
+    if (TTF_GlyphMetrics32(mFont, ch, &minx, &maxx, &miny, &maxy, &glyph.advance) != 0){
+        return;
+    }
+    if (maxx > minx && maxy > miny){
+        surf = TTF_RenderGlyph32_Blended(mFont, ch, white);
+    }
+#else
+    if (ch > 0xFFFF || TTF_GlyphMetrics(mFont, static_cast<Uint16>(ch), &minx, &maxx, &miny, &maxy, &glyph.advance) != 0){
+        return;
+    }
+    if (maxx > minx && maxy > miny){
+        surf = TTF_RenderGlyph_Blended(mFont, static_cast<Uint16>(ch), white);
+    }
+#endif
+    if (surf == nullptr){
+        // Nothing to draw (a space, or a glyph the font lacks); only the advance matters.
+        return;
+    }
+
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGBA8888, 0);
+    SDL_FreeSurface(surf);
+    if (rgba == nullptr){
+        return;
+    }
+    glyph.texture = Place(rgba, glyph.rect);
+    SDL_FreeSurface(rgba);
+}
+
+SDL_Texture* GlyphAtlas::Place(SDL_Surface* surf, SDL_Rect &rect){
+    // A pixel of space is left around each glyph, so scaled text never samples its neighbours.
+    size_t page = 0;
+    SDL_Rect packed;
+    for (; page < mPages.size(); page++){
+        if (mPages[page].packer.insert(surf->w + 2, surf->h + 2, packed)){
+            break;
+        }
+    }
+    if (page == mPages.size()){
+        SDL_Renderer* r = mWindow.IsValid() ? mWindow->getSDLRenderer().get() : nullptr;
+        if (r == nullptr){
+            return nullptr;
+        }
+        int width = std::max(mPageSize, surf->w + 2);
+        int height = std::max(mPageSize, surf->h + 2);
+        SDL_Texture* tex = SDL_CreateTexture(r, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, width, height);
+        if (tex == nullptr){
+            return nullptr;
+        }
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+        // New textures hold garbage; the padding has to be transparent.
+        std::vector<Uint32> clear(static_cast<size_t>(width)*height, 0);
+        SDL_UpdateTexture(tex, nullptr, &clear[0], width*4);
+
+        mPages.push_back(sPage(width, height));
+        mPages.back().texture.reset(tex, SDL_DestroyTexture);
+        mPages.back().packer.insert(surf->w + 2, surf->h + 2, packed);
+    }
+
+    rect.x = packed.x + 1;
+    rect.y = packed.y + 1;
+    rect.w = surf->w;
+    rect.h = surf->h;
+    SDL_UpdateTexture(mPages[page].texture.get(), &rect, surf->pixels, surf->pitch);
+    return mPages[page].texture.get();
+}
+
+
+} // End namespace "engine"
@@ -0,0 +1,137 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "Window.h"
+#include "AtlasPacker.h"
+
+
+namespace engine{
+
+class GlyphAtlas;
+typedef std::shared_ptr<GlyphAtlas> GlyphAtlasPtr;
+
+
+/** \class
+* \brief Caches the glyphs of one font, rasterized once each, on atlas textures of one window.
+*
+* Glyphs are rendered white on first use and packed onto atlas pages. Text is then drawn as one quad per glyph through
+* the window's sprite batch, tinted to the wanted color, so a string costs no rasterizing or texture uploads once its
+* glyphs have been seen, and all text in a frame draws with one call per page.
+* Text is UTF-8. Each string is decoded and shaped (glyphs looked up, advances and kerning applied) once, and the placed
+* glyphs are cached by string, so drawing the same text again skips decoding, lookups and kerning queries altogether.
+* NOTE: Not thread-safe; the Writer serializes all use of its atlases (and their fonts).
+*/
+class GlyphAtlas
+{
+    public:
+        struct sGlyph{
+            SDL_Texture* texture;   /**< The page holding the glyph, or nullptr if it has nothing to draw (spaces). */
+            SDL_Rect rect;          /**< Where the glyph is on its page. */
+            int advance;            /**< Horizontal distance to the next glyph's origin. */
+        };
+
+        struct sPlacedGlyph{
+            const sGlyph* glyph;
+            int x;                  /**< Offset of the glyph's origin from the start of the text. */
+        };
+
+        struct sRun{
+            std::vector<sPlacedGlyph> glyphs;   /**< Only the glyphs with something to draw. */
+            int width;
+        };
+
+        static const int DEFAULT_PAGE_SIZE = 512;
+
+        GlyphAtlas(TTF_Font* font, WindowHnd win, int pageSize=DEFAULT_PAGE_SIZE);
+
+        /**
+        * Returns the glyph of the given character, rasterizing it first if it hasn't been used yet.
+        */
+        const sGlyph* glyph(Uint32 ch);
+
+        /**
+        * Returns the kerning adjustment, in pixels, between two consecutive characters.
+        */
+        int kerning(Uint32 previous, Uint32 ch);
+
+        /**
+        * Returns the given UTF-8 text shaped into placed glyphs, from the cache if it has been shaped before.
+        * The run is only valid until the next call; the cache is emptied when it fills up.
+        */
+        const sRun& shape(const std::string &text);
+
+        /**
+        * Queues the text, with its top left corner at x, y, on the window's sprite batch. Returns the width drawn.
+        */
+        int draw(const std::string &text, int x, int y, const SDL_Color &color);
+
+        /**
+        * Returns the width the text would be drawn at.
+        */
+        int measure(const std::string &text);
+
+    private:
+        struct sPage{
+            AtlasPacker packer;
+            std::shared_ptr<SDL_Texture> texture;
+
+            sPage(int width, int height) : packer(width, height){}
+        };
+
+        TTF_Font* mFont;
+        WindowHnd mWindow;
+        int mPageSize;
+        bool mKerning;
+        std::vector<sPage> mPages;
+
+        // Printable ASCII is looked up directly; everything else goes through the map.
+        static const Uint32 DIRECT_GLYPHS = 128;
+        sGlyph mDirect[DIRECT_GLYPHS];
+        bool mDirectReady[DIRECT_GLYPHS];
+        std::unordered_map<Uint32, sGlyph> mGlyphs;
+
+        // Shaped text by string. Cleared whole when full, as text that changes every frame would otherwise crowd it.
+        std::unordered_map<std::string, sRun> mRuns;
+        std::vector<Uint32> mDecoded;
+        static const size_t MAX_CACHED_RUNS = 1024;
+
+        void Rasterize(Uint32 ch, sGlyph &glyph);
+        SDL_Texture* Place(SDL_Surface* surf, SDL_Rect &rect);
+};
+
+
+} // End namespace "engine"
+
+#endif // GLYPHATLAS_H
@@ -0,0 +1,166 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "JobPool.h"
+
+
+namespace engine{
+
+
+JobPoolPtr JobPool::mInstance;
+
+JobPool::JobPool(unsigned int threadCount) : mStopping(false){
+    if (threadCount == 0){
+        unsigned int hw = boost::thread::hardware_concurrency();
+        threadCount = hw > 1 ? hw - 1 : 1;
+    }
+    for (unsigned int i = 0; i < threadCount; i++){
+        mWorkers.create_thread(boost::bind(&JobPool::WorkerLoop, this));
+    }
+}
+
+JobPool::~JobPool(){
+    {
+        boost::mutex::scoped_lock lock(mPoolProtection);
+        mStopping = true;
+    }
+    mJobAvailable.notify_all();
+    mWorkers.join_all();
+}
+
+JobPoolPtr JobPool::getInstance(){
+    if (mInstance.get() == 0){
+        mInstance = JobPoolPtr(new JobPool());
+    }
+    return mInstance;
+}
+
+unsigned int JobPool::threadCount(){
+    return static_cast<unsigned int>(mWorkers.size());
+}
+
+
+void JobPool::submit(const Job &job){
+    {
+        boost::mutex::scoped_lock lock(mPoolProtection);
+        mJobs.push_back(job);
+    }
+    mJobAvailable.notify_one();
+}
+
+
+void JobPool::runAndWait(const JobList &jobs){
+    if (jobs.empty()){
+        return;
+    }
+
+    JobBatchPtr batch(new sJobBatch());
+    batch->jobs = &jobs;
+    batch->count = jobs.size();
+    batch->next = 0;
+    batch->remaining = jobs.size();
+
+    // One helper per job beyond the one this thread will start on. Each helper claims jobs until the batch runs dry, so
+    // helpers that start late simply find nothing left and return.
+    {
+        boost::mutex::scoped_lock lock(mPoolProtection);
+        for (size_t i = 1; i < jobs.size() && i <= mWorkers.size(); i++){
+            mJobs.push_front(boost::bind(&JobPool::DrainBatch, batch));
+        }
+    }
+    mJobAvailable.notify_all();
+
+    DrainBatch(batch);
+
+    boost::mutex::scoped_lock lock(batch->protection);
+    while (batch->remaining > 0){
+        batch->done.wait(lock);
+    }
+    if (batch->error){
+        std::rethrow_exception(batch->error);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+
+void JobPool::WorkerLoop(){
+    while (true){
+        Job job;
+        {
+            boost::mutex::scoped_lock lock(mPoolProtection);
+            while (mJobs.empty() && !mStopping){
+                mJobAvailable.wait(lock);
+            }
+            if (mJobs.empty()){
+                return; // Stopping, and nothing left to do.
+            }
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+
+        try{
+            job();
+        } catch (...) {
+            // Submitted jobs report their own failures. Nothing useful can be done with it here.
+        }
+    }
+}
+
+void JobPool::DrainBatch(JobBatchPtr batch){
+    while (RunBatchJob(batch)){}
+}
+
+bool JobPool::RunBatchJob(JobBatchPtr batch){
+    size_t index = 0;
+    {
+        boost::mutex::scoped_lock lock(batch->protection);
+        // Compared against the stored count, not jobs->size(), as a late helper may get here after the caller has
+        // returned and the job list is gone.
+        if (batch->next >= batch->count){
+            return false;
+        }
+        index = batch->next++;
+    }
+
+    std::exception_ptr error;
+    try{
+        batch->jobs->at(index)();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    boost::mutex::scoped_lock lock(batch->protection);
+    if (error && !batch->error){
+        batch->error = error;
+    }
+    batch->remaining--;
+    if (batch->remaining == 0){
+        batch->done.notify_all();
+    }
+    return true;
+}
+
+
+} // End namespace "engine"
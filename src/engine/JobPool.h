@@ -0,0 +1,131 @@
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <exception>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace engine{
+
+class JobPool;
+/** \typedef
+* \brief std::shared_ptr<JobPool>
+*/
+typedef std::shared_ptr<JobPool> JobPoolPtr;
+
+/** \class
+* \brief A fixed set of worker threads that run jobs handed to them.
+*
+* Jobs can either be submitted to run whenever a worker is free (submit), or run as a batch the caller waits on
+* (runAndWait). While waiting on a batch, the calling thread works through the batch itself, so a batch always completes
+* even if every worker is busy with long running submitted jobs.
+*
+* \author Bryan Miller
+* \version 1.0.0
+*/
+class JobPool
+{
+    public:
+        /** \typedef A void() function signature */
+        typedef void JobSignature();
+        /** \typedef boost::function<JobSignature> */
+        typedef boost::function<JobSignature> Job;
+        typedef std::vector<Job> JobList;
+
+        /**
+        * Starts the worker threads. A threadCount of 0 (zero) starts one worker per hardware thread, less the calling one.
+        */
+        JobPool(unsigned int threadCount=0);
+
+        /**
+        * Finishes all jobs already submitted, then joins the worker threads.
+        */
+        ~JobPool();
+
+        /**
+        * Queues a job to run on the next free worker. This method is thread-safe.
+        * Exceptions thrown by a submitted job are caught and discarded; the job is expected to report its own failures.
+        */
+        void submit(const Job &job);
+
+        /**
+        * Runs every job in the list, spread across the workers and the calling thread, and returns once they have all finished.
+        * If any job throws, the first exception thrown is rethrown here after the whole batch has finished.
+        */
+        void runAndWait(const JobList &jobs);
+
+        unsigned int threadCount();
+
+        /**
+        * Returns the shared engine job pool, starting it on first use.
+        */
+        static JobPoolPtr getInstance();
+
+    private:
+        static JobPoolPtr mInstance;
+
+        struct sJobBatch{
+            const JobList *jobs;
+            size_t count;
+            size_t next;
+            size_t remaining;
+            std::exception_ptr error;
+            boost::mutex protection;
+            boost::condition_variable done;
+        };
+        typedef std::shared_ptr<sJobBatch> JobBatchPtr;
+
+        boost::thread_group mWorkers;
+        std::deque<Job> mJobs;
+        bool mStopping;
+        boost::mutex mPoolProtection;
+        boost::condition_variable mJobAvailable;
+
+        void WorkerLoop();
+
+        /**
+        * Runs jobs from the batch until none are left to claim.
+        */
+        static void DrainBatch(JobBatchPtr batch);
+
+        /**
+        * Claims and runs the next unclaimed job of the batch. Returns false if no job was left to claim.
+        */
+        static bool RunBatchJob(JobBatchPtr batch);
+};
+
+
+} // End namespace "engine"
+
+#endif // JOBPOOL_H
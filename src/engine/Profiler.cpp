@@ -0,0 +1,232 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+
+namespace engine{
+
+
+ProfilerPtr Profiler::mInstance;
+
+// Nesting depth of the zones open on the current thread.
+static thread_local unsigned int tZoneDepth = 0;
+
+// Sorts zone totals with the most expensive first.
+static bool ZoneStatsGreater(const Profiler::sZoneStats &a, const Profiler::sZoneStats &b){
+    return a.ms > b.ms;
+}
+
+
+Profiler::Profiler() : mEnabled(true), mCapturing(false), mCaptureStart(0){
+    mFrameStart = SDL_GetPerformanceCounter();
+    mTicksToMS = 1000.0/static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+ProfilerPtr Profiler::getInstance(){
+    if (mInstance.get() == 0){
+        mInstance = ProfilerPtr(new Profiler());
+    }
+    return mInstance;
+}
+
+
+void Profiler::setEnabled(bool enable){
+    mEnabled = enable;
+}
+
+bool Profiler::enabled(){
+    return mEnabled;
+}
+
+
+void Profiler::recordZone(const char* name, Uint64 start, Uint64 end, unsigned int depth){
+    sThreadBuffer* buffer = GetThreadBuffer();
+
+    // Only endFrame ever waits on this lock, and only for as long as it takes to copy the buffer out.
+    boost::mutex::scoped_lock lock(buffer->protection);
+    sZoneSample &sample = buffer->samples[buffer->written % buffer->samples.size()];
+    sample.name = name;
+    sample.start = start;
+    sample.end = end;
+    sample.depth = depth;
+    buffer->written++;
+}
+
+
+void Profiler::endFrame(){
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    boost::mutex::scoped_lock lock(mProfilerProtection);
+
+    typedef std::map<const char*, sZoneStats> ZoneTotals;
+    ZoneTotals totals;
+    for (size_t b = 0; b < mThreadBuffers.size(); b++){
+        sThreadBuffer* buffer = mThreadBuffers.at(b).get();
+        boost::mutex::scoped_lock bufferLock(buffer->protection);
+
+        // If the thread lapped its ring buffer, the oldest zones are gone.
+        size_t capacity = buffer->samples.size();
+        if (buffer->written - buffer->read > capacity){
+            buffer->read = buffer->written - capacity;
+        }
+
+        for (; buffer->read < buffer->written; buffer->read++){
+            const sZoneSample &sample = buffer->samples[buffer->read % capacity];
+            sZoneStats &zs = totals[sample.name];
+            zs.name = sample.name;
+            zs.ms += static_cast<double>(sample.end - sample.start)*mTicksToMS;
+            zs.calls++;
+
+            if (mCapturing){
+                sCapturedZone cz;
+                cz.sample = sample;
+                cz.threadID = buffer->threadID;
+                mCapture.push_back(cz);
+            }
+        }
+    }
+
+    mLastFrameZones.clear();
+    for (ZoneTotals::iterator item = totals.begin(); item != totals.end(); item++){
+        mLastFrameZones.push_back(item->second);
+    }
+    std::sort(mLastFrameZones.begin(), mLastFrameZones.end(), ZoneStatsGreater);
+
+    mFrameTimes.push_back(static_cast<double>(now - mFrameStart)*mTicksToMS);
+    while (mFrameTimes.size() > HISTORY_SIZE){
+        mFrameTimes.pop_front();
+    }
+    mFrameStart = now;
+}
+
+
+void Profiler::getFrameTimes(std::vector<double> &times){
+    boost::mutex::scoped_lock lock(mProfilerProtection);
+    times.assign(mFrameTimes.begin(), mFrameTimes.end());
+}
+
+void Profiler::getZoneStats(ZoneStatsList &stats){
+    boost::mutex::scoped_lock lock(mProfilerProtection);
+    stats = mLastFrameZones;
+}
+
+
+void Profiler::startCapture(){
+    boost::mutex::scoped_lock lock(mProfilerProtection);
+    mCapture.clear();
+    mCaptureStart = SDL_GetPerformanceCounter();
+    mCapturing = true;
+}
+
+void Profiler::stopCapture(){
+    boost::mutex::scoped_lock lock(mProfilerProtection);
+    mCapturing = false;
+}
+
+bool Profiler::capturing(){
+    return mCapturing;
+}
+
+bool Profiler::exportChromeTrace(const std::string &path){
+    boost::mutex::scoped_lock lock(mProfilerProtection);
+
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+    if (!out){
+        return false;
+    }
+
+    // Chrome traces are in microseconds.
+    double ticksToUS = mTicksToMS*1000.0;
+    out << "{\"traceEvents\":[";
+    for (size_t index = 0; index < mCapture.size(); index++){
+        const sCapturedZone &cz = mCapture.at(index);
+        std::string name(cz.sample.name);
+        std::string escaped;
+        for (size_t c = 0; c < name.size(); c++){
+            if (name[c] == '"' || name[c] == '\\'){
+                escaped += '\\';
+            }
+            escaped += name[c];
+        }
+        // Zones started before the capture get clamped to its start.
+        double ts = cz.sample.start > mCaptureStart ? static_cast<double>(cz.sample.start - mCaptureStart)*ticksToUS : 0.0;
+        double dur = static_cast<double>(cz.sample.end - cz.sample.start)*ticksToUS;
+
+        if (index > 0){
+            out << ",";
+        }
+        out << "\n{\"name\":\"" << escaped << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << cz.threadID
+            << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+
+// -----------------------------------------------------------------------------
+
+Profiler::sThreadBuffer* Profiler::GetThreadBuffer(){
+    static thread_local sThreadBuffer* tBuffer = nullptr;
+    if (tBuffer == nullptr){
+        ThreadBufferPtr buffer(new sThreadBuffer());
+        buffer->samples.resize(THREAD_BUFFER_SIZE);
+        buffer->written = 0;
+        buffer->read = 0;
+
+        boost::mutex::scoped_lock lock(mProfilerProtection);
+        buffer->threadID = static_cast<unsigned int>(mThreadBuffers.size()) + 1;
+        mThreadBuffers.push_back(buffer);
+        tBuffer = buffer.get();
+    }
+    return tBuffer;
+}
+
+
+// -----------------------------------------------------------------------------
+
+ProfileZone::ProfileZone(const char* name) : mName(name), mStart(0), mDepth(0){
+    Profiler* p = Profiler::mInstance.get();
+    if (p == 0){
+        p = Profiler::getInstance().get();
+    }
+    if (p->mEnabled){
+        mDepth = ++tZoneDepth;
+        mStart = SDL_GetPerformanceCounter();
+    }
+}
+
+ProfileZone::~ProfileZone(){
+    if (mDepth > 0){
+        Uint64 end = SDL_GetPerformanceCounter();
+        tZoneDepth--;
+        Profiler::mInstance->recordZone(mName, mStart, end, mDepth);
+    }
+}
+
+
+} // End namespace "engine"
@@ -0,0 +1,186 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include <boost/thread/mutex.hpp>
+
+#include <SDL2/SDL.h>
+
+namespace engine{
+
+class Profiler;
+/** \typedef
+* \brief std::shared_ptr<Profiler>
+*/
+typedef std::shared_ptr<Profiler> ProfilerPtr;
+
+/** \class
+* \brief [SINGLETON] Collects timing zones from every thread and aggregates them per frame.
+*
+* Zones are recorded with ProfileZone (or the ENGINE_PROFILE_ZONE macro) into a ring buffer owned by the recording thread,
+* so recording never contends with other threads. Once a frame, endFrame() drains every ring buffer and totals the time
+* spent in each zone for that frame. A history of frame times and the last frame's zone totals are kept for display, and
+* a capture of raw zones can be exported in the Chrome trace event format (chrome://tracing).
+*
+* Zone names must be string literals (or otherwise outlive the profiler), as only the pointer is stored.
+*/
+class Profiler
+{
+    public:
+        struct sZoneStats{
+            const char* name;
+            double ms;
+            unsigned int calls;
+        };
+        typedef std::vector<sZoneStats> ZoneStatsList;
+
+        /** Number of frames kept in the frame time history. */
+        static const size_t HISTORY_SIZE = 240;
+        /** Number of zones each thread can record between two endFrame calls before the oldest are overwritten. */
+        static const size_t THREAD_BUFFER_SIZE = 8192;
+
+        /**
+        * Enables or disables zone recording. When disabled, zones cost a single flag check.
+        */
+        void setEnabled(bool enable);
+        bool enabled();
+
+        /**
+        * Closes the current frame, aggregating every zone recorded since the last call. Called once per frame by the main loop.
+        */
+        void endFrame();
+
+        /**
+        * Fills times with the recorded frame times in milliseconds, oldest first.
+        */
+        void getFrameTimes(std::vector<double> &times);
+
+        /**
+        * Fills stats with the zone totals of the last completed frame, most expensive first.
+        */
+        void getZoneStats(ZoneStatsList &stats);
+
+        /**
+        * Starts keeping every recorded zone, for export with exportChromeTrace.
+        */
+        void startCapture();
+        void stopCapture();
+        bool capturing();
+
+        /**
+        * Writes the captured zones to the given file as a Chrome trace. Returns false if the file could not be written.
+        */
+        bool exportChromeTrace(const std::string &path);
+
+        /**
+        * Records a finished zone on the calling thread. Used by ProfileZone.
+        */
+        void recordZone(const char* name, Uint64 start, Uint64 end, unsigned int depth);
+
+        static ProfilerPtr getInstance();
+
+    private:
+        struct sZoneSample{
+            const char* name;
+            Uint64 start;
+            Uint64 end;
+            unsigned int depth;
+        };
+
+        struct sThreadBuffer{
+            unsigned int threadID;
+            std::vector<sZoneSample> samples;
+            size_t written;
+            size_t read;
+            boost::mutex protection;
+        };
+        typedef std::shared_ptr<sThreadBuffer> ThreadBufferPtr;
+
+        struct sCapturedZone{
+            sZoneSample sample;
+            unsigned int threadID;
+        };
+
+        static ProfilerPtr mInstance;
+
+        bool mEnabled;
+        bool mCapturing;
+        Uint64 mFrameStart;
+        double mTicksToMS;
+
+        std::vector<ThreadBufferPtr> mThreadBuffers;
+        std::deque<double> mFrameTimes;
+        ZoneStatsList mLastFrameZones;
+        std::vector<sCapturedZone> mCapture;
+        Uint64 mCaptureStart;
+
+        // Guards the thread buffer list, statistics and capture. Never held while a zone is recorded.
+        boost::mutex mProfilerProtection;
+
+        Profiler();
+
+        sThreadBuffer* GetThreadBuffer();
+
+        friend class ProfileZone;
+};
+
+
+/** \class
+* \brief Times the scope it lives in as a named profiler zone.
+*/
+class ProfileZone
+{
+    public:
+        ProfileZone(const char* name);
+        ~ProfileZone();
+    private:
+        const char* mName;
+        Uint64 mStart;
+        unsigned int mDepth;
+};
+
+
+} // End namespace "engine"
+
+
+/**
+* Times the rest of the enclosing scope as a zone of the given name. Defining ENGINE_PROFILER_DISABLED compiles every zone out.
+*/
+#ifdef ENGINE_PROFILER_DISABLED
+    #define ENGINE_PROFILE_ZONE(name)
+#else
+    #define ENGINE_PROFILE_ZONE_CONCAT2(a, b) a##b
+    #define ENGINE_PROFILE_ZONE_CONCAT(a, b) ENGINE_PROFILE_ZONE_CONCAT2(a, b)
+    #define ENGINE_PROFILE_ZONE(name) engine::ProfileZone ENGINE_PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
+#endif
+
+#endif // PROFILER_H
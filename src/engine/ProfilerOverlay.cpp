@@ -0,0 +1,167 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "ProfilerOverlay.h"
+
+#include <cstdio>
+#include <iostream>
+
+
+namespace engine{
+
+
+const double ProfilerOverlay::GRAPH_MAX_MS = 50.0;
+const double ProfilerOverlay::TARGET_FRAME_MS = 1000.0/60.0;
+
+ProfilerOverlay::ProfilerOverlay(WindowHnd win, std::string fontName, std::string tracePath){
+    registerCapabilities(this);
+    mWindow = win;
+    mFontName = fontName;
+    mTracePath = tracePath;
+    mX = 10;
+    mY = 10;
+}
+
+
+void ProfilerOverlay::start(){
+    mWriter = Writer::getHandle();
+    Profiler::getInstance()->setEnabled(true);
+}
+
+void ProfilerOverlay::stop(){
+    ProfilerPtr p = Profiler::getInstance();
+    if (p->capturing()){
+        p->stopCapture();
+        p->exportChromeTrace(mTracePath);
+    }
+}
+
+void ProfilerOverlay::getFocus(){}
+
+void ProfilerOverlay::looseFocus(){}
+
+bool ProfilerOverlay::isOverlay(){
+    return true;
+}
+
+void ProfilerOverlay::setPosition(int x, int y){
+    mX = x;
+    mY = y;
+}
+
+
+void ProfilerOverlay::render(){
+    ENGINE_PROFILE_ZONE("ProfilerOverlay::render");
+    if (!mWindow.IsValid()){
+        return;
+    }
+
+    ProfilerPtr p = Profiler::getInstance();
+    p->getFrameTimes(mFrameTimes);
+    p->getZoneStats(mZoneStats);
+
+    SDL_Color oldPen;
+    mWindow->getPenColor(&oldPen);
+
+    int graphWidth = static_cast<int>(Profiler::HISTORY_SIZE)*GRAPH_POINT_SPACING;
+
+    // Frame of the graph, then the 60fps budget line.
+    SDL_Point box[5];
+    box[0].x = mX;              box[0].y = mY;
+    box[1].x = mX + graphWidth; box[1].y = mY;
+    box[2].x = mX + graphWidth; box[2].y = mY + GRAPH_HEIGHT;
+    box[3].x = mX;              box[3].y = mY + GRAPH_HEIGHT;
+    box[4] = box[0];
+    mWindow->setPenColor(96, 96, 96);
+    mWindow->drawLines(box, 5);
+
+    mWindow->setPenColor(160, 160, 32);
+    int targetY = GraphY(TARGET_FRAME_MS);
+    mWindow->drawLine(mX, targetY, mX + graphWidth, targetY);
+
+    // Newest frame on the right edge.
+    if (mFrameTimes.size() > 1){
+        mGraphPoints.resize(mFrameTimes.size());
+        int startX = mX + graphWidth - static_cast<int>(mFrameTimes.size()-1)*GRAPH_POINT_SPACING;
+        for (size_t index = 0; index < mFrameTimes.size(); index++){
+            mGraphPoints[index].x = startX + static_cast<int>(index)*GRAPH_POINT_SPACING;
+            mGraphPoints[index].y = GraphY(mFrameTimes.at(index));
+        }
+        mWindow->setPenColor(64, 255, 64);
+        mWindow->drawLines(&mGraphPoints[0], static_cast<int>(mGraphPoints.size()));
+    }
+    mWindow->setPenColor(&oldPen);
+
+    if (mWriter.IsValid() && mWriter->hasFont(mFontName)){
+        SDL_Color oldWriterPen;
+        mWriter->getPenColor(&oldWriterPen);
+        mWriter->setPenColor(200, 200, 200);
+
+        int lineHeight = mWriter->getFontPixelHeight(mFontName) + 2;
+        int y = mY + GRAPH_HEIGHT + 4;
+        char line[128];
+
+        double last = mFrameTimes.empty() ? 0.0 : mFrameTimes.back();
+        snprintf(line, sizeof(line), "frame %.2fms%s", last, p->capturing() ? "  [capturing]" : "");
+        mWriter->presentToWindow(mWindow, mFontName, line, mX, y);
+        y += lineHeight;
+
+        for (size_t index = 0; index < mZoneStats.size() && index < static_cast<size_t>(ZONE_LINES); index++){
+            const Profiler::sZoneStats &zs = mZoneStats.at(index);
+            snprintf(line, sizeof(line), "%6.2fms %4u  %s", zs.ms, zs.calls, zs.name);
+            mWriter->presentToWindow(mWindow, mFontName, line, mX, y);
+            y += lineHeight;
+        }
+        mWriter->setPenColor(&oldWriterPen);
+    }
+}
+
+
+bool ProfilerOverlay::poll(SDL_Event event){
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F12){
+        ProfilerPtr p = Profiler::getInstance();
+        if (p->capturing()){
+            p->stopCapture();
+            if (!p->exportChromeTrace(mTracePath)){
+                std::cout << "Failed to write profiler trace \"" << mTracePath << "\"." << std::endl;
+            }
+        } else {
+            p->startCapture();
+        }
+        return true;
+    }
+    return false;
+}
+
+
+// PRIVATE
+int ProfilerOverlay::GraphY(double ms){
+    if (ms > GRAPH_MAX_MS){
+        ms = GRAPH_MAX_MS;
+    }
+    return mY + GRAPH_HEIGHT - static_cast<int>((ms/GRAPH_MAX_MS)*GRAPH_HEIGHT);
+}
+
+
+} // End namespace "engine"
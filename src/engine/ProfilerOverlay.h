@@ -0,0 +1,93 @@
+#ifndef PROFILEROVERLAY_H
+#define PROFILEROVERLAY_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "States.h"
+#include "Renderables.h"
+#include "IOStates.h"
+#include "Window.h"
+#include "Writer.h"
+#include "Profiler.h"
+
+namespace engine{
+
+
+/** \class
+* \brief Overlay state that draws the Profiler's frame time graph and the most expensive zones of the last frame.
+*
+* Push it onto a GameStateManager to show it; it does not take focus from the state beneath it.
+* While shown, F12 starts a Chrome trace capture, and pressing it again writes the capture to the trace path.
+*/
+class ProfilerOverlay : public IState, public IRenderable, public IIOState
+{
+    public:
+        ProfilerOverlay(WindowHnd win, std::string fontName, std::string tracePath="profile_trace.json");
+
+        void start();
+        void stop();
+
+        void getFocus();
+        void looseFocus();
+        bool isOverlay();
+
+        void render();
+        bool poll(SDL_Event event);
+
+        /**
+        * Moves the top left corner of the overlay.
+        */
+        void setPosition(int x, int y);
+
+    private:
+        static const int GRAPH_HEIGHT = 120;
+        static const int GRAPH_POINT_SPACING = 2;
+        static const int ZONE_LINES = 8;
+        static const double GRAPH_MAX_MS;
+        static const double TARGET_FRAME_MS;
+
+        WindowHnd mWindow;
+        WriterHnd mWriter;
+        std::string mFontName;
+        std::string mTracePath;
+        int mX;
+        int mY;
+
+        std::vector<double> mFrameTimes;
+        std::vector<SDL_Point> mGraphPoints;
+        Profiler::ZoneStatsList mZoneStats;
+
+        int GraphY(double ms);
+};
+
+
+} // End namespace "engine"
+
+#endif // PROFILEROVERLAY_H
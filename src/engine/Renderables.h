@@ -35,6 +35,13 @@ namespace engine{
 class IRenderable{
 public:
     virtual void render()=0;
+
+    /**
+    * Called by a fixed timestep loop, where alpha (0.0 to 1.0) is how far the current frame sits between the last update
+    * and the next one. Renderables that interpolate their motion override this; all others are simply rendered.
+    * Named apart from render() so that overriding one doesn't hide the other.
+    */
+    virtual void renderInterpolated(float){render();}
 protected:
     IRenderable(){}
 };
@@ -23,6 +23,7 @@
 */
 
 #include "Resource.h"
+#include "VirtualFileSystem.h"
 
 #include <stdexcept>
 #include <cstdio>
@@ -31,9 +32,11 @@
 namespace engine{
 
 
-Resource::Resource(){mURI = "";}
+unsigned int Resource::mUseClock = 0;
 
-Resource::Resource(std::string uri){
+Resource::Resource() : mLastUsed(0){mURI = "";}
+
+Resource::Resource(std::string uri) : mLastUsed(0){
     if (!resourceExists(uri)){
         throw std::runtime_error("Resource doesn't exist.");
     }
@@ -45,14 +48,8 @@ std::string Resource::getURI(){
 }
 
 bool Resource::resourceExists(std::string uri){
-    if (uri != ""){
-        // TODO: (MAYBE) Extend this to allow for a virtual file system at a later date.
-        if (FILE* file = fopen(uri.c_str(), "r")){
-            fclose(file);
-            return true;
-        }
-    }
-    return false;
+    // Mounted archives answer from their index; only loose files cost a stat.
+    return VirtualFileSystem::getInstance()->exists(uri);
 }
 
 
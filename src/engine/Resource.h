@@ -26,6 +26,7 @@
 */
 
 #include <string>
+#include <cstddef>
 
 
 namespace engine{
@@ -42,8 +43,34 @@ class Resource
         virtual bool isPrepared()=0;
         virtual std::string getURI();
 
+        /**
+        * Estimated number of bytes release() would free. Used to keep resource managers within a memory budget.
+        */
+        virtual size_t estimatedBytes(){return 0;}
+
+        /**
+        * Returns true if release() can be undone by prepare(), which is what allows a manager to release it under memory
+        * pressure. Resources whose contents only exist in memory (render targets, for instance) must return false.
+        */
+        virtual bool reloadable(){return false;}
+
+        /**
+        * Marks the resource as used on the current tick of the use clock. Resources call this whenever they are drawn or
+        * otherwise used, and managers release the least recently used first.
+        */
+        void touch(){mLastUsed = mUseClock;}
+        unsigned int lastUsed(){return mLastUsed;}
+
+        /**
+        * Advances the use clock. Called once a frame by the main loop.
+        */
+        static void AdvanceUseClock(){mUseClock++;}
+        static unsigned int UseClock(){return mUseClock;}
+
     protected:
         std::string mURI;
+        unsigned int mLastUsed;
+        static unsigned int mUseClock;
         virtual bool resourceExists(std::string uri);
     private:
 };
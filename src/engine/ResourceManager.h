@@ -27,6 +27,15 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include <boost/function.hpp>
+
+#include "Resource.h"
 
 namespace engine{
 
@@ -34,23 +43,32 @@ namespace engine{
 template <typename T, typename H>
 /**
 * The base resource management class for all future resource managers.
+*
+* Resources are stored by name, with a hashed index of their URIs so lookups by URI don't scan. Users of a resource may
+* also count their references to it with addRef and dropRef. A resource whose count drops back to zero is remembered as
+* unused, and evictUnused removes every such resource, calling the eviction hook for each first.
+* Resources that were never referenced this way are never evicted.
+*
+* Separately, a memory budget can be set. enforceBudget then releases (rather than removes) the least recently used
+* reloadable resources until the estimated memory of those prepared fits, and they prepare again lazily the next time
+* they are used. enforceBudget and memoryUsed require T to point to a Resource.
 */
 class ResourceManager
 {
     public:
-        ResourceManager(){}
+        /** \typedef A void(const std::string &name, const T &resource) function signature */
+        typedef void EvictionHookSignature(const std::string &, const T &);
+        /** \typedef boost::function<EvictionHookSignature> */
+        typedef boost::function<EvictionHookSignature> EvictionHook;
+
+        ResourceManager() : mMemoryBudget(0){}
 
         bool has(std::string name){
             return mResources.find(name) != mResources.end();
         }
 
         bool hasByURI(std::string uri){
-            for(ResourceMapIter item = mResources.begin(); item != mResources.end(); item++){
-                if (item->second->getURI() == uri){
-                    return true;
-                }
-            }
-            return false;
+            return mURIIndex.find(uri) != mURIIndex.end();
         }
 
         H get(std::string name){
@@ -62,18 +80,186 @@ class ResourceManager
         }
 
         H getByURI(std::string uri){
-            for(ResourceMapIter item = mResources.begin(); item != mResources.end(); item++){
-                if (item->second->getURI() == uri){
-                    return H(item->second);
+            URIIndexIter index = mURIIndex.find(uri);
+            if (index != mURIIndex.end()){
+                return get(index->second);
+            }
+            return H();
+        }
+
+        /**
+        * Returns the named resource, counting one more reference to it. Every addRef should be paired with a dropRef.
+        */
+        H addRef(std::string name){
+            ResourceMapIter item = mResources.find(name);
+            if (item != mResources.end()){
+                if (mRefCounts[name]++ == 0){
+                    mUnused.erase(name);
                 }
+                return H(item->second);
             }
             return H();
         }
 
+        /**
+        * Counts one less reference to the named resource. Once none are left, the resource becomes a candidate for evictUnused.
+        */
+        void dropRef(std::string name){
+            RefCountIter count = mRefCounts.find(name);
+            if (count != mRefCounts.end() && count->second > 0){
+                if (--count->second == 0){
+                    mUnused.insert(name);
+                }
+            }
+        }
+
+        unsigned int refCount(std::string name){
+            RefCountIter count = mRefCounts.find(name);
+            return count != mRefCounts.end() ? count->second : 0;
+        }
+
+        /**
+        * Removes the named resource, whatever its reference count. Returns false if there was no such resource.
+        */
+        bool remove(std::string name){
+            ResourceMapIter item = mResources.find(name);
+            if (item == mResources.end()){
+                return false;
+            }
+            Unindex(name);
+            mResources.erase(item);
+            mRefCounts.erase(name);
+            mUnused.erase(name);
+            return true;
+        }
+
+        /**
+        * Removes every resource whose reference count has dropped back to zero. Returns the number removed.
+        */
+        size_t evictUnused(){
+            std::vector<std::string> names(mUnused.begin(), mUnused.end());
+            for (size_t i = 0; i < names.size(); i++){
+                ResourceMapIter item = mResources.find(names[i]);
+                if (item != mResources.end() && mEvictionHook){
+                    mEvictionHook(names[i], item->second);
+                }
+                remove(names[i]);
+            }
+            return names.size();
+        }
+
+        /**
+        * Sets the function called with each resource evictUnused is about to remove.
+        */
+        void setEvictionHook(const EvictionHook &hook){
+            mEvictionHook = hook;
+        }
+
+        /**
+        * Sets the number of bytes (see Resource::estimatedBytes) prepared resources may use. 0 (zero) means no limit.
+        */
+        void setMemoryBudget(size_t bytes){
+            mMemoryBudget = bytes;
+        }
+
+        size_t getMemoryBudget(){
+            return mMemoryBudget;
+        }
+
+        /**
+        * Returns the estimated bytes used by all prepared resources.
+        */
+        size_t memoryUsed(){
+            size_t used = 0;
+            for (ResourceMapIter item = mResources.begin(); item != mResources.end(); item++){
+                if (item->second->isPrepared()){
+                    used += item->second->estimatedBytes();
+                }
+            }
+            return used;
+        }
+
+        /**
+        * Releases the least recently used reloadable resources until memoryUsed fits the budget. Resources used on the
+        * current tick of the use clock are never released, as they may still be waiting to be drawn. Returns the bytes freed.
+        */
+        size_t enforceBudget(){
+            if (mMemoryBudget == 0){
+                return 0;
+            }
+            size_t used = 0;
+            mEvictionCandidates.clear();
+            for (ResourceMapIter item = mResources.begin(); item != mResources.end(); item++){
+                if (item->second->isPrepared()){
+                    size_t bytes = item->second->estimatedBytes();
+                    used += bytes;
+                    if (bytes > 0 && item->second->lastUsed() != Resource::UseClock() && item->second->reloadable()){
+                        mEvictionCandidates.push_back(std::make_pair(item->second->lastUsed(), item));
+                    }
+                }
+            }
+            if (used <= mMemoryBudget){
+                return 0;
+            }
+
+            std::sort(mEvictionCandidates.begin(), mEvictionCandidates.end(), [](const EvictionCandidate &a, const EvictionCandidate &b){
+                return a.first < b.first;
+            });
+            size_t freed = 0;
+            for (size_t i = 0; i < mEvictionCandidates.size() && used - freed > mMemoryBudget; i++){
+                T &resource = mEvictionCandidates[i].second->second;
+                freed += resource->estimatedBytes();
+                resource->release();
+            }
+            mEvictionCandidates.clear();
+            return freed;
+        }
+
     protected:
         typedef std::map<std::string, T> ResourceMap;
         typedef typename ResourceMap::iterator ResourceMapIter;
         ResourceMap mResources;
+
+        /**
+        * Stores a resource under the given name, replacing any resource stored under it, and indexes it by the given URI.
+        * All additions to mResources go through here so the index stays in step.
+        */
+        void store(const std::string &name, const T &resource, const std::string &uri){
+            Unindex(name);
+            mResources[name] = resource;
+            if (uri != ""){
+                mURIIndex[uri] = name;
+                mResourceURIs[name] = uri;
+            }
+        }
+
+    private:
+        typedef std::unordered_map<std::string, std::string> URIIndex;
+        typedef typename URIIndex::iterator URIIndexIter;
+        typedef std::unordered_map<std::string, unsigned int> RefCountMap;
+        typedef typename RefCountMap::iterator RefCountIter;
+
+        URIIndex mURIIndex;
+        URIIndex mResourceURIs;
+        RefCountMap mRefCounts;
+        std::unordered_set<std::string> mUnused;
+        EvictionHook mEvictionHook;
+
+        size_t mMemoryBudget;
+        // Kept between calls so enforceBudget doesn't allocate every frame.
+        typedef std::pair<unsigned int, ResourceMapIter> EvictionCandidate;
+        std::vector<EvictionCandidate> mEvictionCandidates;
+
+        void Unindex(const std::string &name){
+            URIIndexIter uri = mResourceURIs.find(name);
+            if (uri != mResourceURIs.end()){
+                URIIndexIter index = mURIIndex.find(uri->second);
+                if (index != mURIIndex.end() && index->second == name){
+                    mURIIndex.erase(index);
+                }
+                mResourceURIs.erase(uri);
+            }
+        }
 };
 
 
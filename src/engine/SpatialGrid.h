@@ -0,0 +1,246 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+
+#include <SDL2/SDL.h>
+
+namespace engine{
+
+
+template <typename T>
+/**
+* A 2D spatial index of items with rectangular bounds, on a sparse uniform grid of square cells.
+*
+* Each item is listed in every cell its bounds touch, and only cells holding items exist, so maps of any size cost memory
+* for what's on them. A query visits the cells overlapping its area and returns each item found there once, so drawing
+* what a viewport shows costs what's in and around the viewport, not what's on the map.
+* Cells should be about the size of the larger items; items much larger than a cell are listed in many cells.
+* NOTE: Not thread-safe.
+*/
+class SpatialGrid
+{
+    public:
+        typedef size_t Id;
+
+        static const int DEFAULT_CELL_SIZE = 128;
+
+        SpatialGrid(int cellSize=DEFAULT_CELL_SIZE) : mCellSize(cellSize > 0 ? cellSize : DEFAULT_CELL_SIZE), mCount(0), mStamp(0){}
+
+        /**
+        * Adds the item with the given bounds, returning the id it's known by until removed. Ids of removed items are reused.
+        */
+        Id insert(const T &item, const SDL_Rect &bounds){
+            Id id;
+            if (!mFree.empty()){
+                id = mFree.back();
+                mFree.pop_back();
+            } else {
+                id = mEntries.size();
+                mEntries.push_back(sEntry());
+            }
+            sEntry &e = mEntries[id];
+            e.item = item;
+            e.bounds = bounds;
+            e.alive = true;
+            e.stamp = 0;
+            CellRange(bounds, e.cells);
+            Link(id);
+            mCount++;
+            return id;
+        }
+
+        /**
+        * Changes the bounds of an item. Cheap while it stays within the same cells.
+        */
+        void move(Id id, const SDL_Rect &bounds){
+            if (id >= mEntries.size() || !mEntries[id].alive){
+                return;
+            }
+            sEntry &e = mEntries[id];
+            e.bounds = bounds;
+            sCellRange cells;
+            CellRange(bounds, cells);
+            if (cells.x0 != e.cells.x0 || cells.y0 != e.cells.y0 || cells.x1 != e.cells.x1 || cells.y1 != e.cells.y1){
+                Unlink(id);
+                e.cells = cells;
+                Link(id);
+            }
+        }
+
+        void remove(Id id){
+            if (id >= mEntries.size() || !mEntries[id].alive){
+                return;
+            }
+            Unlink(id);
+            mEntries[id].alive = false;
+            mEntries[id].item = T();
+            mFree.push_back(id);
+            mCount--;
+        }
+
+        void clear(){
+            mEntries.clear();
+            mFree.clear();
+            mCells.clear();
+            mCount = 0;
+        }
+
+        size_t size() const{
+            return mCount;
+        }
+
+        bool has(Id id) const{
+            return id < mEntries.size() && mEntries[id].alive;
+        }
+
+        T& get(Id id){
+            return mEntries[id].item;
+        }
+
+        const SDL_Rect& getBounds(Id id) const{
+            return mEntries[id].bounds;
+        }
+
+        /**
+        * Appends every item whose bounds overlap the area to out, each once, in no particular order.
+        */
+        void query(const SDL_Rect &area, std::vector<T> &out){
+            if (area.w <= 0 || area.h <= 0){
+                return;
+            }
+            NextStamp();
+            sCellRange cells;
+            CellRange(area, cells);
+            for (int cy = cells.y0; cy <= cells.y1; cy++){
+                for (int cx = cells.x0; cx <= cells.x1; cx++){
+                    typename CellMap::const_iterator cell = mCells.find(CellKey(cx, cy));
+                    if (cell == mCells.end()){
+                        continue;
+                    }
+                    for (size_t i = 0; i < cell->second.size(); i++){
+                        sEntry &e = mEntries[cell->second[i]];
+                        if (e.stamp != mStamp){
+                            e.stamp = mStamp;
+                            if (SDL_HasIntersection(&e.bounds, &area)){
+                                out.push_back(e.item);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        struct sCellRange{
+            int x0, y0, x1, y1;
+        };
+
+        struct sEntry{
+            T item;
+            SDL_Rect bounds;
+            sCellRange cells;
+            bool alive;
+            Uint32 stamp;   /**< The query that last saw the item, so items in several cells are returned once. */
+        };
+
+        typedef std::unordered_map<Uint64, std::vector<Id> > CellMap;
+
+        int mCellSize;
+        size_t mCount;
+        Uint32 mStamp;
+        std::vector<sEntry> mEntries;
+        std::vector<Id> mFree;
+        CellMap mCells;
+
+        static Uint64 CellKey(int cx, int cy){
+            return (static_cast<Uint64>(static_cast<Uint32>(cx)) << 32) | static_cast<Uint32>(cy);
+        }
+
+        int CellOf(int coordinate) const{
+            // Rounds down for negative coordinates too.
+            return static_cast<int>(std::floor(static_cast<double>(coordinate)/mCellSize));
+        }
+
+        void CellRange(const SDL_Rect &bounds, sCellRange &cells) const{
+            cells.x0 = CellOf(bounds.x);
+            cells.y0 = CellOf(bounds.y);
+            cells.x1 = CellOf(bounds.x + (bounds.w > 0 ? bounds.w - 1 : 0));
+            cells.y1 = CellOf(bounds.y + (bounds.h > 0 ? bounds.h - 1 : 0));
+        }
+
+        void Link(Id id){
+            const sCellRange &cells = mEntries[id].cells;
+            for (int cy = cells.y0; cy <= cells.y1; cy++){
+                for (int cx = cells.x0; cx <= cells.x1; cx++){
+                    mCells[CellKey(cx, cy)].push_back(id);
+                }
+            }
+        }
+
+        void Unlink(Id id){
+            const sCellRange &cells = mEntries[id].cells;
+            for (int cy = cells.y0; cy <= cells.y1; cy++){
+                for (int cx = cells.x0; cx <= cells.x1; cx++){
+                    typename CellMap::iterator cell = mCells.find(CellKey(cx, cy));
+                    if (cell == mCells.end()){
+                        continue;
+                    }
+                    std::vector<Id> &ids = cell->second;
+                    for (size_t i = 0; i < ids.size(); i++){
+                        if (ids[i] == id){
+                            // Order within a cell doesn't matter.
+                            ids[i] = ids.back();
+                            ids.pop_back();
+                            break;
+                        }
+                    }
+                    if (ids.empty()){
+                        mCells.erase(cell);
+                    }
+                }
+            }
+        }
+
+        void NextStamp(){
+            mStamp++;
+            if (mStamp == 0){
+                // Wrapped; forget every stamp so none is mistaken for the new one.
+                for (size_t i = 0; i < mEntries.size(); i++){
+                    mEntries[i].stamp = 0;
+                }
+                mStamp = 1;
+            }
+        }
+};
+
+
+} // End namespace "engine"
+
+#endif // SPATIALGRID_H
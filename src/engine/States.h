@@ -26,22 +26,119 @@
 */
 
 #include <memory>
+#include <atomic>
+#include <type_traits>
 //#include <boost/shared_ptr.hpp>
 //#include <boost/weak_ptr.hpp>
 
+#include "Updateables.h"
+#include "Renderables.h"
+#include "IOStates.h"
+#include "RenderSnapshot.h"
+
 namespace engine{
 
 
+/**
+* The interfaces a state has registered with registerCapabilities. One bit per interface.
+*/
+enum StateCapability {
+    StateCap_None = 0,
+    StateCap_Updateable = 1 << 0,
+    StateCap_Renderable = 1 << 1,
+    StateCap_IO = 1 << 2,
+    StateCap_RenderSnapshot = 1 << 3,
+    /** Held until registerCapabilities is called, so a state manager can tell a state that forgot to register from one with no interfaces. */
+    StateCap_Unregistered = 1 << 30
+};
+
+
 class IState{
 public:
+    /**
+    * Optional asynchronous loading step, run on a worker thread when the state is preloaded through a state manager
+    * (see GameStateManager::preloadState). Load and decode everything that doesn't need the renderer here, and report
+    * progress with setPrepareProgress. It must not create textures or otherwise touch the renderer.
+    * start() is then the activation step, run on the main thread, and should only do the work left over, such as
+    * uploading textures. States that are added without being preloaded get start() alone.
+    */
+    virtual void prepare(){}
+
     virtual void start()=0;
     virtual void stop()=0;
 
     virtual void getFocus()=0;
     virtual void looseFocus()=0;
 
+    /**
+    * Overlay states are drawn over the states beneath them without taking their focus. Pushing or dropping an overlay
+    * does not call looseFocus or getFocus on the state below it.
+    */
+    virtual bool isOverlay(){return false;}
+
+    /** Returned by idleUntil when the state only ever changes in response to input. */
+    static const unsigned int IDLE_FOREVER = 0xFFFFFFFF;
+
+    /**
+    * Returns the SDL_GetTicks() time at which the state next changes on its own (its next animation frame, timer, etc),
+    * or IDLE_FOREVER. Until then, and unless input arrives, the main loop may sleep and skip rendering altogether.
+    * The default of 0 (zero) means the state is always animating, which keeps the loop running every frame.
+    */
+    virtual unsigned int idleUntil(){return 0;}
+
+    /**
+    * Returns the StateCapability bits registered by the state. A state manager only dispatches to the interfaces listed here.
+    * Returns StateCap_Unregistered if registerCapabilities was never called.
+    */
+    unsigned int capabilities(){return mCapabilities;}
+
+    IUpdateable* asUpdateable(){return mUpdateable;}
+    IRenderable* asRenderable(){return mRenderable;}
+    IIOState* asIOState(){return mIOState;}
+    IRenderSnapshot* asRenderSnapshot(){return mRenderSnapshot;}
+
+    /**
+    * Returns how far prepare() has come, from 0.0 to 1.0. Safe to call from any thread, such as a loading screen's render().
+    */
+    float prepareProgress(){return mPrepareProgress.load();}
+
 protected:
-    IState(){}
+    IState() : mCapabilities(StateCap_Unregistered), mUpdateable(nullptr), mRenderable(nullptr), mIOState(nullptr), mRenderSnapshot(nullptr),
+               mPrepareProgress(0.0f){}
+
+    void setPrepareProgress(float progress){mPrepareProgress.store(progress);}
+
+    /**
+    * Registers every state interface the concrete state implements. Must be called once from the concrete state's constructor
+    * with its own this pointer, before the state is handed to a state manager. A state manager refuses states that never called it.
+    * The interfaces are resolved at compile time, so no RTTI is involved.
+    */
+    template<typename T>
+    void registerCapabilities(T* self){
+        mUpdateable = CapabilityCast<IUpdateable>(self, std::is_base_of<IUpdateable, T>());
+        mRenderable = CapabilityCast<IRenderable>(self, std::is_base_of<IRenderable, T>());
+        mIOState = CapabilityCast<IIOState>(self, std::is_base_of<IIOState, T>());
+        mRenderSnapshot = CapabilityCast<IRenderSnapshot>(self, std::is_base_of<IRenderSnapshot, T>());
+
+        mCapabilities = StateCap_None;
+        if (mUpdateable != nullptr){mCapabilities |= StateCap_Updateable;}
+        if (mRenderable != nullptr){mCapabilities |= StateCap_Renderable;}
+        if (mIOState != nullptr){mCapabilities |= StateCap_IO;}
+        if (mRenderSnapshot != nullptr){mCapabilities |= StateCap_RenderSnapshot;}
+    }
+
+private:
+    unsigned int mCapabilities;
+    IUpdateable* mUpdateable;
+    IRenderable* mRenderable;
+    IIOState* mIOState;
+    IRenderSnapshot* mRenderSnapshot;
+    std::atomic<float> mPrepareProgress;
+
+    template<typename I, typename T>
+    static I* CapabilityCast(T* self, std::true_type){return static_cast<I*>(self);}
+    template<typename I, typename T>
+    static I* CapabilityCast(T*, std::false_type){return nullptr;}
 };
 typedef std::shared_ptr<IState> StatePtr;
 
@@ -0,0 +1,254 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#include "TextLayout.h"
+#include "Utf8.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+
+namespace engine{
+
+
+TextLayout::TextLayout(std::string fontName, int wrapWidth, Alignment align) : mFontName(fontName), mWrapWidth(wrapWidth), mAlign(align), mWidth(0){
+    mWriter = Writer::getHandle();
+    if (!mWriter.IsValid()){
+        throw std::runtime_error("Failed to obtain Writer object.");
+    }
+    mLineHeight = mWriter->getFontPixelHeight(fontName);
+}
+
+void TextLayout::setText(const std::string &text){
+    mText = text;
+    mRuns.clear();
+    mWidth = 0;
+    LayoutFrom(0);
+}
+
+void TextLayout::append(const std::string &text){
+    if (text.empty()){
+        return;
+    }
+    size_t offset = 0;
+    if (!mRuns.empty()){
+        // Only the last line can change; the ones before it are already as full as they'll get.
+        offset = mRuns.back().offset;
+        mRuns.pop_back();
+    }
+    mText += text;
+    LayoutFrom(offset);
+}
+
+void TextLayout::clear(){
+    setText("");
+}
+
+const std::string& TextLayout::getText() const{
+    return mText;
+}
+
+void TextLayout::setWrapWidth(int wrapWidth){
+    if (wrapWidth != mWrapWidth){
+        mWrapWidth = wrapWidth;
+        setText(mText);
+    }
+}
+
+int TextLayout::getWrapWidth() const{
+    return mWrapWidth;
+}
+
+void TextLayout::setAlignment(Alignment align){
+    if (align != mAlign){
+        mAlign = align;
+        AlignRuns(0);
+    }
+}
+
+TextLayout::Alignment TextLayout::getAlignment() const{
+    return mAlign;
+}
+
+const std::vector<TextLayout::sRun>& TextLayout::runs() const{
+    return mRuns;
+}
+
+int TextLayout::width() const{
+    return mWidth;
+}
+
+int TextLayout::height() const{
+    return static_cast<int>(mRuns.size())*mLineHeight;
+}
+
+int TextLayout::lineHeight() const{
+    return mLineHeight;
+}
+
+void TextLayout::draw(WindowHnd win, int x, int y, const SDL_Rect* clip){
+    ENGINE_PROFILE_ZONE("TextLayout::draw");
+    if (!win.IsValid() || mRuns.empty()){
+        return;
+    }
+
+    size_t first = 0;
+    size_t last = mRuns.size();
+    if (clip != nullptr && mLineHeight > 0){
+        // Lines are evenly spaced, so the visible ones are found from the clip alone.
+        int top = clip->y - y;
+        int bottom = clip->y + clip->h - y;
+        first = top > 0 ? static_cast<size_t>(top/mLineHeight) : 0;
+        last = bottom > 0 ? std::min(last, static_cast<size_t>((bottom + mLineHeight - 1)/mLineHeight)) : 0;
+    }
+
+    for (size_t index = first; index < last; index++){
+        const sRun &run = mRuns.at(index);
+        if (!run.text.empty()){
+            mWriter->presentToWindow(win, mFontName, run.text, x + run.x, y + run.y);
+        }
+    }
+}
+
+
+// PRIVATE
+void TextLayout::LayoutFrom(size_t offset){
+    ENGINE_PROFILE_ZONE("TextLayout::LayoutFrom");
+    size_t firstNew = mRuns.size();
+    int oldWidth = mWidth;
+    int y = static_cast<int>(mRuns.size())*mLineHeight;
+
+    size_t start = offset;
+    while (true){
+        size_t end = mText.find('\n', start);
+        if (end == std::string::npos){
+            WrapParagraph(start, mText.size(), y);
+            break;
+        }
+        WrapParagraph(start, end, y);
+        start = end + 1;
+    }
+
+    // Unwrapped text aligns to the widest line, so a new widest line moves all of them.
+    if (mWrapWidth <= 0 && mAlign != Align_Left && mWidth != oldWidth){
+        AlignRuns(0);
+    } else {
+        AlignRuns(firstNew);
+    }
+}
+
+// PRIVATE
+void TextLayout::WrapParagraph(size_t start, size_t end, int &y){
+    int spaceWidth = mWriter->getFontStringWidth(mFontName, " ");
+    size_t lineStart = start;
+    size_t lineEnd = start;
+    int lineWidth = 0;
+    size_t pos = start;
+
+    while (pos < end){
+        size_t spaceStart = pos;
+        while (pos < end && mText[pos] == ' '){
+            pos++;
+        }
+        int spacesWidth = static_cast<int>(pos - spaceStart)*spaceWidth;
+        size_t wordEnd = pos;
+        while (wordEnd < end && mText[wordEnd] != ' '){
+            wordEnd++;
+        }
+        if (wordEnd == pos){
+            // Trailing spaces; they're not part of the line.
+            break;
+        }
+
+        int wordWidth = mWriter->getFontStringWidth(mFontName, mText.substr(pos, wordEnd - pos));
+        if (mWrapWidth > 0 && lineEnd > lineStart && lineWidth + spacesWidth + wordWidth > mWrapWidth){
+            // Wrap before the word, dropping the spaces in between.
+            PushRun(lineStart, lineEnd, lineWidth, y);
+            y += mLineHeight;
+            lineStart = lineEnd = pos;
+            lineWidth = spacesWidth = 0;
+        }
+
+        if (mWrapWidth > 0 && lineEnd == lineStart && spacesWidth + wordWidth > mWrapWidth){
+            // The word doesn't fit a line on its own, so it's broken between characters (never inside one).
+            int width = spacesWidth;
+            for (size_t cut = pos, next; cut < wordEnd; cut = next){
+                next = Utf8::Next(mText, cut);
+                int charWidth = mWriter->getFontStringWidth(mFontName, mText.substr(cut, next - cut));
+                if (width + charWidth > mWrapWidth && cut > lineStart){
+                    PushRun(lineStart, cut, width, y);
+                    y += mLineHeight;
+                    lineStart = cut;
+                    width = 0;
+                }
+                width += charWidth;
+            }
+            lineWidth = width;
+        } else {
+            lineWidth += spacesWidth + wordWidth;
+        }
+        lineEnd = wordEnd;
+        pos = wordEnd;
+    }
+
+    // Empty paragraphs still take a line.
+    PushRun(lineStart, lineEnd, lineWidth, y);
+    y += mLineHeight;
+}
+
+// PRIVATE
+void TextLayout::PushRun(size_t start, size_t end, int width, int y){
+    sRun run;
+    run.text = mText.substr(start, end - start);
+    run.offset = start;
+    run.x = 0;
+    run.y = y;
+    run.width = width;
+    mRuns.push_back(run);
+    if (width > mWidth){
+        mWidth = width;
+    }
+}
+
+// PRIVATE
+void TextLayout::AlignRuns(size_t first){
+    int span = mWrapWidth > 0 ? mWrapWidth : mWidth;
+    for (size_t index = first; index < mRuns.size(); index++){
+        sRun &run = mRuns.at(index);
+        switch (mAlign){
+        case Align_Center:
+            run.x = (span - run.width)/2;
+            break;
+        case Align_Right:
+            run.x = span - run.width;
+            break;
+        default:
+            run.x = 0;
+        }
+    }
+}
+
+
+} // End namespace "engine"
@@ -0,0 +1,114 @@
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <SDL2/SDL.h>
+
+#include "Window.h"
+#include "Writer.h"
+
+
+namespace engine{
+
+class TextLayout;
+typedef std::shared_ptr<TextLayout> TextLayoutPtr;
+
+
+/** \class
+* \brief Lays a block of text out into positioned lines, wrapped to a width and aligned.
+*
+* Text is broken into lines at newlines and, when a wrap width is set, between words (or inside words too long to fit a
+* line on their own). Word widths come from Writer::getFontStringWidth, which caches them per font and string, so text
+* made of the same words measures almost for free.
+* Appending only lays out again from the start of the last line, as wrapping never changes the lines before it; logs,
+* chat and other growing text cost the size of what was added, not of the whole text.
+* NOTE: Not thread-safe, but may be built on any thread (the Writer serializes the measuring).
+*/
+class TextLayout
+{
+    public:
+        enum Alignment {Align_Left, Align_Center, Align_Right};
+
+        struct sRun{
+            std::string text;   /**< The line's text, without the spaces it was wrapped at. */
+            size_t offset;      /**< Where the line starts in the layout's text. */
+            int x;              /**< Position of the line relative to the layout's top left corner. */
+            int y;
+            int width;
+        };
+
+        /**
+        * A wrap width of 0 or less never wraps lines. Text is then aligned to the widest line.
+        */
+        TextLayout(std::string fontName, int wrapWidth=0, Alignment align=Align_Left);
+
+        void setText(const std::string &text);
+        void append(const std::string &text);
+        void clear();
+        const std::string& getText() const;
+
+        void setWrapWidth(int wrapWidth);
+        int getWrapWidth() const;
+        void setAlignment(Alignment align);
+        Alignment getAlignment() const;
+
+        const std::vector<sRun>& runs() const;
+        int width() const;
+        int height() const;
+        int lineHeight() const;
+
+        /**
+        * Draws the lines, with the layout's top left corner at x, y, in the Writer's pen color. If a clip is given, only
+        * lines overlapping it vertically are drawn. Lines share one fixed height, so those are worked out from the clip
+        * directly, and tall layouts cost only their visible lines.
+        */
+        void draw(WindowHnd win, int x, int y, const SDL_Rect* clip=nullptr);
+
+    private:
+        WriterHnd mWriter;
+        std::string mFontName;
+        int mWrapWidth;
+        Alignment mAlign;
+        std::string mText;
+        std::vector<sRun> mRuns;
+        int mLineHeight;
+        int mWidth;
+
+        /** Lays out the text from the given offset, which starts a line, adding to the runs already there. */
+        void LayoutFrom(size_t offset);
+        void WrapParagraph(size_t start, size_t end, int &y);
+        void PushRun(size_t start, size_t end, int width, int y);
+        void AlignRuns(size_t first);
+};
+
+
+} // End namespace "engine"
+
+#endif // TEXTLAYOUT_H
@@ -0,0 +1,116 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "TextPanel.h"
+#include "Profiler.h"
+
+
+namespace engine{
+
+
+TextPanel::TextPanel(std::string fontName, int width, int height) : mFontName(fontName), mWidth(width), mHeight(height), mFirst(0), mCount(0){
+    mWriter = Writer::getHandle();
+    if (!mWriter.IsValid()){
+        throw std::runtime_error("Failed to obtain Writer object.");
+    }
+    mLineHeight = mWriter->getFontPixelHeight(fontName);
+    if (mLineHeight <= 0){
+        throw std::runtime_error(std::string("Font \"") + fontName + std::string("\" not defined."));
+    }
+    mSlots.resize(height > mLineHeight ? static_cast<size_t>(height/mLineHeight) : 1);
+    mColor.r = mColor.g = mColor.b = mColor.a = 255;
+}
+
+void TextPanel::push(const std::string &line){
+    size_t slot;
+    if (mCount < mSlots.size()){
+        slot = (mFirst + mCount) % mSlots.size();
+        mCount++;
+    } else {
+        slot = mFirst;
+        mFirst = (mFirst + 1) % mSlots.size();
+    }
+    // Assigning into the slot reuses its string's storage.
+    mSlots[slot].text = line;
+    mSlots[slot].width = mWriter->getFontStringWidth(mFontName, line);
+}
+
+void TextPanel::clear(){
+    mFirst = 0;
+    mCount = 0;
+}
+
+size_t TextPanel::lineCount() const{
+    return mCount;
+}
+
+size_t TextPanel::capacity() const{
+    return mSlots.size();
+}
+
+int TextPanel::width() const{
+    return mWidth;
+}
+
+int TextPanel::height() const{
+    return mHeight;
+}
+
+void TextPanel::setColor(const SDL_Color &color){
+    mColor = color;
+}
+
+void TextPanel::draw(WindowHnd win, int x, int y){
+    ENGINE_PROFILE_ZONE("TextPanel::draw");
+    if (!win.IsValid() || mCount == 0){
+        return;
+    }
+
+    bool clip = false;
+    for (size_t i = 0; i < mCount && !clip; i++){
+        clip = mSlots[(mFirst + i) % mSlots.size()].width > mWidth;
+    }
+    if (clip){
+        SDL_Rect bounds = {x, y, mWidth, mHeight};
+        win->pushClipRect(bounds);
+    }
+
+    SDL_Color oldWriterPen;
+    mWriter->getPenColor(&oldWriterPen);
+    mWriter->setPenColor(&mColor);
+    for (size_t i = 0; i < mCount; i++){
+        const sLine &line = mSlots[(mFirst + i) % mSlots.size()];
+        if (!line.text.empty()){
+            mWriter->presentToWindow(win, mFontName, line.text, x, y + static_cast<int>(i)*mLineHeight);
+        }
+    }
+    mWriter->setPenColor(&oldWriterPen);
+
+    if (clip){
+        win->popClipRect();
+    }
+}
+
+
+} // End namespace "engine"
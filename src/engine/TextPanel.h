@@ -0,0 +1,98 @@
+#ifndef TEXTPANEL_H
+#define TEXTPANEL_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <SDL2/SDL.h>
+
+#include "Window.h"
+#include "Writer.h"
+
+
+namespace engine{
+
+class TextPanel;
+typedef std::shared_ptr<TextPanel> TextPanelPtr;
+
+
+/** \class
+* \brief A fixed size panel of scrolling lines of text, such as a console or log view.
+*
+* Lines are kept in a ring of as many slots as fit the panel; pushing a line onto a full panel reuses the oldest slot,
+* so scrolling moves nothing and, once the slots' strings have grown to fit, allocates nothing. Lines are drawn through
+* the Writer's glyph atlases, so no textures are created for them either, and their widths are measured once, when
+* pushed, to know whether the panel needs clipping.
+* NOTE: Not thread-safe.
+*/
+class TextPanel
+{
+    public:
+        TextPanel(std::string fontName, int width, int height);
+
+        /**
+        * Adds a line at the bottom of the panel, scrolling the oldest line out if the panel is full.
+        */
+        void push(const std::string &line);
+        void clear();
+
+        size_t lineCount() const;
+        size_t capacity() const;
+        int width() const;
+        int height() const;
+
+        void setColor(const SDL_Color &color);
+
+        /**
+        * Draws the lines, oldest at the top, with the panel's top left corner at x, y. Lines wider than the panel are cut
+        * at its right edge.
+        */
+        void draw(WindowHnd win, int x, int y);
+
+    private:
+        struct sLine{
+            std::string text;
+            int width;
+        };
+
+        WriterHnd mWriter;
+        std::string mFontName;
+        int mWidth;
+        int mHeight;
+        int mLineHeight;
+        SDL_Color mColor;
+
+        std::vector<sLine> mSlots;
+        size_t mFirst;
+        size_t mCount;
+};
+
+
+} // End namespace "engine"
+
+#endif // TEXTPANEL_H
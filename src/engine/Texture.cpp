@@ -23,6 +23,7 @@
 */
 
 #include "Texture.h"
+#include "VirtualFileSystem.h"
 
 
 namespace engine{
@@ -30,7 +31,7 @@ namespace engine{
 
     Texture::~Texture(){}
 
-    Texture::Texture(std::string uri, WindowHnd win) : Resource(uri){
+    Texture::Texture(std::string uri, WindowHnd win) : Resource(uri), mPending(false){
         mTexture = SDL_TexturePtr();
 
         if (!win.IsValid()){
@@ -43,11 +44,55 @@ namespace engine{
         } catch (std::runtime_error e){
             throw e;
         }
+    }
+
+    Texture::Texture(SDL_SurfacePtr surface, WindowHnd win) : Resource(), mPending(false){
+        mTexture = SDL_TexturePtr();
+
+        if (!win.IsValid()){
+            throw std::runtime_error("Cannot Create Texture: Window pointer invalid.");
+        }
+        if (surface.get() == 0){
+            throw std::runtime_error("Cannot Create Texture: Surface invalid.");
+        }
+        mTexWindow = win;
+        mSurface = surface;
+        try{
+            CreateSurfaceTexture();
+        } catch (std::runtime_error e){
+            throw e;
+        }
+    }
 
-        SDL_QueryTexture(mTexture.get(), &mFormat, &mAccess, &mWidth, &mHeight);
+    Texture::Texture(TexturePtr atlas, const SDL_Rect &region, std::string uri) : Resource(), mPending(false){
+        if (atlas.get() == 0){
+            throw std::runtime_error("Cannot Create Texture: Atlas texture invalid.");
+        }
+        mURI = uri;
+        mAtlas = atlas;
+        mRegion = region;
+        mTexWindow = atlas->mTexWindow;
+        mTexture = SDL_TexturePtr();
+        mFormat = atlas->mFormat;
+        mAccess = atlas->mAccess;
+        mWidth = region.w;
+        mHeight = region.h;
     }
 
-    Texture::Texture(WindowHnd win, int w, int h, Uint32 format, int access) : Resource(){
+    Texture::Texture(std::string uri, WindowHnd win, TexturePtr placeholder) : Resource(uri), mPending(true){
+        mTexture = SDL_TexturePtr();
+
+        if (!win.IsValid()){
+            throw std::runtime_error("Cannot Create Texture: Window pointer invalid.");
+        }
+        mTexWindow = win;
+        mPlaceholder = placeholder;
+        mFormat = SDL_PIXELFORMAT_RGBA8888;
+        mAccess = SDL_TEXTUREACCESS_STATIC;
+        mWidth = mHeight = 0;
+    }
+
+    Texture::Texture(WindowHnd win, int w, int h, Uint32 format, int access) : Resource(), mPending(false){
         mTexture = SDL_TexturePtr();
 
         if (!win.IsValid()){
@@ -63,9 +108,20 @@ namespace engine{
 
 
     bool Texture::prepare(){
+        touch();
+        if (mPending){
+            // Never loaded here; the image arrives through upload().
+            return false;
+        }
+        if (mAtlas.get() != 0){
+            // Regions always draw through the page, so releasing the page really frees it.
+            return mAtlas->prepare();
+        }
         if (mTexture.get() == 0){
             try{
-                if (mURI != ""){
+                if (mSurface.get() != 0){
+                    CreateSurfaceTexture();
+                } else if (mURI != ""){
                     LoadTexture();
                 } else {
                     CreateBlankTexture(mFormat, mAccess, mWidth, mHeight);
@@ -87,10 +143,29 @@ namespace engine{
     }
 
     bool Texture::isPrepared(){
+        if (mAtlas.get() != 0){
+            return mAtlas->isPrepared();
+        }
         return mTexture.get() != 0 && mTexWindow.IsValid();
     }
 
 
+    size_t Texture::estimatedBytes(){
+        if (mAtlas.get() != 0 || mTexture.get() == 0){
+            return 0;
+        }
+        size_t bpp = SDL_BYTESPERPIXEL(mFormat);
+        if (bpp == 0){
+            bpp = 4;
+        }
+        return static_cast<size_t>(mWidth)*mHeight*bpp;
+    }
+
+    bool Texture::reloadable(){
+        return mAtlas.get() == 0 && !mPending && (mSurface.get() != 0 || mURI != "");
+    }
+
+
     WindowHnd Texture::getWindow(){
         return mTexWindow;
     }
@@ -103,11 +178,49 @@ namespace engine{
     }
 
     void Texture::queryInfo(Uint32 *fmt, int *access, int *width, int *height){
-        if (mTexture.get() != 0){
-            SDL_QueryTexture(mTexture.get(), fmt, access, width, height);
+        if (SDLTexture() != nullptr){
+            SDL_QueryTexture(SDLTexture(), fmt, access, width, height);
+            if (mAtlas.get() != 0){
+                if (width != nullptr){*width = mRegion.w;}
+                if (height != nullptr){*height = mRegion.h;}
+            }
         }
     }
 
+    bool Texture::isPending(){
+        return mPending;
+    }
+
+    void Texture::upload(SDL_Surface* surface){
+        if (surface == nullptr || !mTexWindow.IsValid()){
+            return;
+        }
+        SDL_Texture* tex = mTexWindow->textureFromSurface(surface);
+        if (tex == nullptr){
+            throw std::runtime_error(SDL_GetError());
+        }
+        SDL_QueryTexture(tex, &mFormat, &mAccess, &mWidth, &mHeight);
+        mTexture.reset(tex, SDL_DestroyTexture);
+        mPending = false;
+        mPlaceholder.reset();
+    }
+
+    bool Texture::getRegion(SDL_Rect *region){
+        if (mAtlas.get() != 0){
+            if (region != nullptr){
+                *region = mRegion;
+            }
+            return true;
+        }
+        return false;
+    }
+
+
+    void Texture::setBlendMode(SDL_BlendMode mode){
+        if (prepare()){
+            SDL_SetTextureBlendMode(SDLTexture(), mode);
+        }
+    }
 
     void Texture::setAsRenderTarget(){
         if (prepare()){
@@ -115,7 +228,7 @@ namespace engine{
             SDL_Texture* tex = mTexture.get();
             if (tex != 0){
                 SDL_QueryTexture(tex, nullptr, &access, nullptr, nullptr);
-                if (access & SDL_RENDERER_TARGETTEXTURE == 0){
+                if (access != SDL_TEXTUREACCESS_TARGET){
                     throw std::runtime_error("Texture not configured to be a render target.");
                 }
 
@@ -143,6 +256,12 @@ namespace engine{
     }
 
     void Texture::render(int x, int y, SDL_Rect* clip){
+        if (mPending){
+            if (mPlaceholder.get() != 0){
+                mPlaceholder->render(x, y);
+            }
+            return;
+        }
         if (prepare()){
             if (mTexWindow.IsValid()){
                 SDL_Rect pos;
@@ -152,16 +271,25 @@ namespace engine{
                     pos.w = clip->w;
                     pos.h = clip->h;
                 } else {
-                    SDL_QueryTexture(mTexture.get(), NULL, NULL, &pos.w, &pos.h);
+                    pos.w = mWidth;
+                    pos.h = mHeight;
                 }
-                mTexWindow->render(mTexture.get(), &pos, clip);
+                SDL_Rect mapped;
+                mTexWindow->render(SDLTexture(), RegionSource(clip, mapped), &pos);
             }
         }
     }
 
     void Texture::render(const SDL_Rect* src, const SDL_Rect* dst, const double& angle, const SDL_Point* center, const SDL_RendererFlip& flip){
+        if (mPending){
+            if (mPlaceholder.get() != 0){
+                mPlaceholder->render(nullptr, dst, angle, center, flip);
+            }
+            return;
+        }
         if (prepare() && mTexWindow.IsValid()){
-            mTexWindow->render(mTexture.get(), src, dst, angle, center, flip);
+            SDL_Rect mapped;
+            mTexWindow->render(SDLTexture(), RegionSource(src, mapped), dst, angle, center, flip);
         }
     }
 
@@ -169,6 +297,50 @@ namespace engine{
         this->render(&state->rect, dst, state->angle, &state->center, state->flip);
     }
 
+    void Texture::batch(const SDL_Rect* src, const SDL_Rect* dst, const double& angle, const SDL_Point* center, const SDL_RendererFlip& flip, const SDL_Color* color){
+        if (mPending){
+            if (mPlaceholder.get() != 0){
+                mPlaceholder->batch(nullptr, dst, angle, center, flip, color);
+            }
+            return;
+        }
+        if (prepare() && mTexWindow.IsValid()){
+            SDL_Rect mapped;
+            mTexWindow->batch(SDLTexture(), RegionSource(src, mapped), dst, angle, center, flip, color);
+        }
+    }
+
+
+    SDL_Surface* Texture::LoadSurface(const std::string &uri){
+        FileData file;
+        if (!VirtualFileSystem::getInstance()->read(uri, file)){
+            return nullptr;
+        }
+        return IMG_Load_RW(file.rwops(), 1);
+    }
+
+    SDL_Texture* Texture::SDLTexture(){
+        if (mAtlas.get() != 0){
+            return mAtlas->mTexture.get();
+        }
+        return mTexture.get();
+    }
+
+    const SDL_Rect* Texture::RegionSource(const SDL_Rect* src, SDL_Rect &mapped){
+        if (mAtlas.get() == 0){
+            return src;
+        }
+        if (src == nullptr){
+            mapped = mRegion;
+        } else {
+            mapped.x = mRegion.x + src->x;
+            mapped.y = mRegion.y + src->y;
+            mapped.w = src->w;
+            mapped.h = src->h;
+        }
+        return &mapped;
+    }
+
 
     void Texture::LoadTexture(){
         if (mTexWindow.IsValid() && mURI != ""){
@@ -179,16 +351,34 @@ namespace engine{
                     throw std::runtime_error("Failed to Load Texture: Could not obtain window renderer instance.");
                 }
 
-                tex = IMG_LoadTexture(renderer.get(), mURI.c_str());
+                FileData file;
+                if (VirtualFileSystem::getInstance()->read(mURI, file)){
+                    tex = IMG_LoadTexture_RW(renderer.get(), file.rwops(), 1);
+                }
                 if (tex == nullptr){
                     throw std::runtime_error("Failed to Load Texture:"); //\"" + IMG_GetError() + "\"");
                 }
+                // Queried once here, so drawing never has to ask the driver for the size.
+                SDL_QueryTexture(tex, &mFormat, &mAccess, &mWidth, &mHeight);
                 mTexture.reset(tex, SDL_DestroyTexture);
             }
         }
     }
 
 
+    void Texture::CreateSurfaceTexture(){
+        if (mTexWindow.IsValid() && mSurface.get() != 0){
+            SDL_Texture* tex = mTexWindow->textureFromSurface(mSurface.get());
+            if (tex == nullptr){
+                throw std::runtime_error(SDL_GetError());
+            }
+            SDL_QueryTexture(tex, &mFormat, &mAccess, &mWidth, &mHeight);
+            mTexture.reset(tex, SDL_DestroyTexture);
+        } else {
+            throw std::runtime_error("Texture Window object is invalid.");
+        }
+    }
+
     void Texture::CreateBlankTexture(Uint32 format, int access, int width, int height){
         if (mTexWindow.get() != 0){
             SDL_Renderer* r = mTexWindow->getSDLRenderer().get();
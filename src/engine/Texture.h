@@ -71,23 +71,86 @@ class Texture : public Resource
     public:
         Texture(WindowHnd win, int w, int h, Uint32 format=SDL_PIXELFORMAT_RGBA8888, int access=SDL_TEXTUREACCESS_STATIC);
         Texture(std::string uri, WindowHnd win);
+
+        /**
+        * Creates a texture from the given surface. The surface is kept, so the texture can be recreated after a release.
+        */
+        Texture(SDL_SurfacePtr surface, WindowHnd win);
+
+        /**
+        * Creates a texture that is the given region of another texture (an atlas page). It draws from, and is prepared and
+        * released with, that texture. Source rectangles passed to render are relative to the region.
+        * The uri, if given, is that of the image the region was packed from.
+        */
+        Texture(TexturePtr atlas, const SDL_Rect &region, std::string uri="");
+
+        /**
+        * Creates a texture for the given image without loading it. The image is decoded elsewhere (see
+        * TextureManager::addTextureAsync) and handed over with upload(). Until then, the placeholder, if given, is drawn in
+        * its place, stretched to the destination.
+        */
+        Texture(std::string uri, WindowHnd win, TexturePtr placeholder);
         ~Texture();
 
         bool prepare();
         void release();
         bool isPrepared();
 
+        /**
+        * Texture memory of the prepared texture (width * height * bytes per pixel). Regions count nothing, as their page
+        * holds the memory.
+        */
+        size_t estimatedBytes();
+
+        /**
+        * True for textures loaded from a URI or created from a surface. Blank textures, which may have been drawn into,
+        * pending textures and regions are not.
+        */
+        bool reloadable();
+
         WindowHnd getWindow();
         void setWindow(WindowHnd win);
 
         void queryInfo(Uint32 *fmt, int *access, int *width, int *height);
 
+        /**
+        * Returns true if this texture is a region of an atlas page, filling region with where it is on the page.
+        */
+        bool getRegion(SDL_Rect *region);
+
+        /**
+        * Returns true while the texture waits for upload().
+        */
+        bool isPending();
+
+        /**
+        * Creates the texture from a decoded surface, ending the wait of a texture created without loading its image.
+        * Must be called on the thread that renders. The surface is not kept; later reloads go through the URI.
+        */
+        void upload(SDL_Surface* surface);
+
+        /**
+        * Sets how the texture blends when drawn. Regions set it for their whole page.
+        */
+        void setBlendMode(SDL_BlendMode mode);
+
         void setAsRenderTarget();
         void clearRenderTarget();
         void render(int x, int y, SDL_Rect* clip=nullptr);
         void render(const SDL_Rect* src, const SDL_Rect* dst, const double& angle, const SDL_Point* center, const SDL_RendererFlip& flip);
         void render(const TextureRenderState *state, const SDL_Rect* dst);
 
+        /**
+        * Same as render, but queued on the window's sprite batch (see Window::batch) with an optional color modulation.
+        */
+        void batch(const SDL_Rect* src, const SDL_Rect* dst, const double& angle=0.0, const SDL_Point* center=nullptr, const SDL_RendererFlip& flip=SDL_FLIP_NONE, const SDL_Color* color=nullptr);
+
+        /**
+        * Decodes the image at the given URI, resolved through the VirtualFileSystem, into a new surface the caller owns.
+        * Returns nullptr if it can't be read or decoded. Safe to call from worker threads.
+        */
+        static SDL_Surface* LoadSurface(const std::string &uri);
+
     protected:
         // TOFO: Decide... Make this part of the Texture class or a child class.
         typedef std::vector<TextureRenderState> TexRenderStateList;
@@ -95,7 +158,12 @@ class Texture : public Resource
         TexRenderStateList mRenderStates;
 
         SDL_TexturePtr mTexture;
+        SDL_SurfacePtr mSurface;
         WindowHnd mTexWindow;
+        TexturePtr mAtlas;
+        SDL_Rect mRegion;
+        TexturePtr mPlaceholder;
+        bool mPending;
         Uint32 mFormat;
         int mAccess;
         int mWidth;
@@ -103,6 +171,13 @@ class Texture : public Resource
 
         void LoadTexture();
         void CreateBlankTexture(Uint32 format, int access, int width, int height);
+        void CreateSurfaceTexture();
+
+        /** The SDL texture drawn from; the page's for a region. */
+        SDL_Texture* SDLTexture();
+
+        /** Maps a source rectangle relative to this texture onto the texture actually drawn from. */
+        const SDL_Rect* RegionSource(const SDL_Rect* src, SDL_Rect &mapped);
     private:
 };
 
@@ -23,6 +23,14 @@
 */
 
 #include "TextureManager.h"
+#include "AtlasPacker.h"
+#include "JobPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/bind.hpp>
 
 
 namespace engine{
@@ -31,7 +39,7 @@ namespace engine{
 
 TextureManager* TextureManager::mInstance = nullptr;
 
-TextureManager::TextureManager() : ResourceManager<TexturePtr, TextureHnd>(){
+TextureManager::TextureManager() : ResourceManager<TexturePtr, TextureHnd>(), mUploadBudget(DEFAULT_UPLOAD_BUDGET), mPendingLoads(0){
     //ResourceManager<TexturePtr, TextureWPtr>();
 }
 
@@ -47,7 +55,29 @@ TextureHnd TextureManager::addTexture(std::string name, std::string uri, WindowH
         if (!hasByURI(uri)){
             try{
                 TexturePtr t = TexturePtr(new Texture(uri, win));
-                mResources.insert(std::pair<std::string, TexturePtr>(name, t));
+                store(name, t, uri);
+                return TextureHnd(t);
+            } catch (std::runtime_error e){
+                throw e;
+            }
+        }
+    }
+    return TextureHnd();
+}
+
+TextureHnd TextureManager::addTextureAsync(std::string name, std::string uri, WindowHnd win, bool allowOverwrite){
+    if (allowOverwrite || !has(name)){
+        if (!hasByURI(uri)){
+            TexturePtr placeholder;
+            ResourceMapIter item = mResources.find(mPlaceholderName);
+            if (item != mResources.end()){
+                placeholder = item->second;
+            }
+            try{
+                TexturePtr t = TexturePtr(new Texture(uri, win, placeholder));
+                store(name, t, uri);
+                mPendingLoads++;
+                JobPool::getInstance()->submit(boost::bind(&TextureManager::DecodeImage, this, uri, std::weak_ptr<Texture>(t)));
                 return TextureHnd(t);
             } catch (std::runtime_error e){
                 throw e;
@@ -57,6 +87,187 @@ TextureHnd TextureManager::addTexture(std::string name, std::string uri, WindowH
     return TextureHnd();
 }
 
+void TextureManager::setPlaceholder(std::string name){
+    mPlaceholderName = name;
+}
+
+int TextureManager::uploadPending(){
+    int uploaded = 0;
+    size_t spent = 0;
+    while (true){
+        DecodedImagePtr image;
+        {
+            boost::mutex::scoped_lock lock(mDecodedProtection);
+            if (mDecoded.empty()){
+                break;
+            }
+            image = mDecoded.front();
+            size_t bytes = image->surface.get() != 0 ? static_cast<size_t>(image->surface->pitch)*image->surface->h : 0;
+            if (mUploadBudget > 0 && uploaded > 0 && spent + bytes > mUploadBudget){
+                break;
+            }
+            spent += bytes;
+            mDecoded.pop_front();
+        }
+        mPendingLoads--;
+
+        TexturePtr t = image->texture.lock();
+        if (t.get() == 0){
+            // Dropped while it was decoding.
+            continue;
+        }
+        if (image->surface.get() == 0){
+            // Decoding failed; it keeps drawing the placeholder.
+            std::cout << "Failed to load texture \"" << t->getURI() << "\"." << std::endl;
+            continue;
+        }
+        ENGINE_PROFILE_ZONE("TextureManager::uploadPending");
+        try{
+            t->upload(image->surface.get());
+            uploaded++;
+        } catch (std::runtime_error e){
+            std::cout << "Failed to upload texture \"" << t->getURI() << "\": " << e.what() << std::endl;
+        }
+    }
+    return uploaded;
+}
+
+void TextureManager::setUploadBudget(size_t bytes){
+    mUploadBudget = bytes;
+}
+
+int TextureManager::pendingLoads(){
+    return mPendingLoads;
+}
+
+int TextureManager::addAtlas(std::string atlasName, const AtlasImageList &images, WindowHnd win, int pageSize){
+    if (!win.IsValid()){
+        throw std::runtime_error("Cannot Create Atlas: Window pointer invalid.");
+    }
+    SDL_RendererInfo rinfo;
+    rinfo.max_texture_width = rinfo.max_texture_height = 0;
+    win->getRenderInfo(rinfo);
+    if (rinfo.max_texture_width > 0 && pageSize > rinfo.max_texture_width){
+        pageSize = rinfo.max_texture_width;
+    }
+    if (rinfo.max_texture_height > 0 && pageSize > rinfo.max_texture_height){
+        pageSize = rinfo.max_texture_height;
+    }
+
+    struct sAtlasEntry{
+        std::string name;
+        std::string uri;
+        SDL_SurfacePtr surface;
+        int page;       /**< -1 for an image too large for a page, which gets a texture of its own. */
+        SDL_Rect rect;
+    };
+    std::vector<sAtlasEntry> entries;
+    for (size_t i = 0; i < images.size(); i++){
+        if (has(images[i].first) || hasByURI(images[i].second)){
+            continue;
+        }
+        SDL_Surface* surf = Texture::LoadSurface(images[i].second);
+        if (surf == nullptr){
+            throw std::runtime_error(std::string("Failed to load atlas image \"") + images[i].second + std::string("\"."));
+        }
+        sAtlasEntry entry;
+        entry.name = images[i].first;
+        entry.uri = images[i].second;
+        entry.surface = SDL_SurfacePtr(surf, SDL_FreeSurface);
+        entry.page = -1;
+        entries.push_back(entry);
+    }
+
+    // Tallest first packs the skyline tightest.
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); i++){
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&entries](size_t a, size_t b){
+        return entries[a].surface->h > entries[b].surface->h;
+    });
+
+    std::vector<AtlasPacker> pages;
+    for (size_t i = 0; i < order.size(); i++){
+        sAtlasEntry &entry = entries[order[i]];
+        int w = entry.surface->w + ATLAS_PADDING*2;
+        int h = entry.surface->h + ATLAS_PADDING*2;
+        if (w > pageSize || h > pageSize){
+            // Widening the page would take it past the renderer's texture size limit.
+            continue;
+        }
+        SDL_Rect rect;
+        for (size_t p = 0; p < pages.size() && entry.page < 0; p++){
+            if (pages[p].insert(w, h, rect)){
+                entry.page = static_cast<int>(p);
+            }
+        }
+        if (entry.page < 0){
+            pages.push_back(AtlasPacker(pageSize, pageSize));
+            pages.back().insert(w, h, rect);
+            entry.page = static_cast<int>(pages.size()) - 1;
+        }
+        entry.rect.x = rect.x + ATLAS_PADDING;
+        entry.rect.y = rect.y + ATLAS_PADDING;
+        entry.rect.w = entry.surface->w;
+        entry.rect.h = entry.surface->h;
+    }
+
+    std::vector<SDL_SurfacePtr> pageSurfaces;
+    for (size_t p = 0; p < pages.size(); p++){
+        SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormat(0, pages[p].width(), pages[p].height(), 32, SDL_PIXELFORMAT_RGBA8888);
+        if (surf == nullptr){
+            throw std::runtime_error(SDL_GetError());
+        }
+        pageSurfaces.push_back(SDL_SurfacePtr(surf, SDL_FreeSurface));
+    }
+    for (size_t i = 0; i < entries.size(); i++){
+        if (entries[i].page < 0){
+            continue;
+        }
+        // Copied as is, alpha included, rather than blended onto the (transparent) page.
+        SDL_SetSurfaceBlendMode(entries[i].surface.get(), SDL_BLENDMODE_NONE);
+        SDL_Rect dst = entries[i].rect;
+        SDL_BlitSurface(entries[i].surface.get(), nullptr, pageSurfaces[entries[i].page].get(), &dst);
+        entries[i].surface.reset();
+    }
+
+    std::vector<TexturePtr> pageTextures;
+    for (size_t p = 0; p < pageSurfaces.size(); p++){
+        TexturePtr t = TexturePtr(new Texture(pageSurfaces[p], win));
+        store(atlasName + std::string("#") + std::to_string(p), t, "");
+        pageTextures.push_back(t);
+    }
+    for (size_t i = 0; i < entries.size(); i++){
+        TexturePtr t;
+        if (entries[i].page < 0){
+            t = TexturePtr(new Texture(entries[i].surface, win));
+        } else {
+            t = TexturePtr(new Texture(pageTextures[entries[i].page], entries[i].rect, entries[i].uri));
+        }
+        store(entries[i].name, t, entries[i].uri);
+    }
+    return static_cast<int>(pageTextures.size());
+}
+
+
+// PRIVATE
+
+void TextureManager::DecodeImage(std::string uri, std::weak_ptr<Texture> texture){
+    DecodedImagePtr image = DecodedImagePtr(new sDecodedImage());
+    image->texture = texture;
+    // Skipped if the texture was dropped before its turn came up.
+    if (!texture.expired()){
+        ENGINE_PROFILE_ZONE("TextureManager::DecodeImage");
+        SDL_Surface* surf = Texture::LoadSurface(uri);
+        if (surf != nullptr){
+            image->surface = SDL_SurfacePtr(surf, SDL_FreeSurface);
+        }
+    }
+    boost::mutex::scoped_lock lock(mDecodedProtection);
+    mDecoded.push_back(image);
+}
+
 
 
 } // End namespace "engine"
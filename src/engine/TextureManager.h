@@ -27,6 +27,11 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <utility>
+#include <deque>
+
+#include <boost/thread/mutex.hpp>
 
 #include "Window.h"
 #include "Texture.h"
@@ -41,12 +46,76 @@ class TextureManager : public ResourceManager<TexturePtr, TextureHnd>
     public:
         TextureHnd addTexture(std::string name, std::string uri, WindowHnd win, bool allowOverwrite = false);
 
+        /** \typedef A (name, uri) pair naming one image to pack into an atlas. */
+        typedef std::pair<std::string, std::string> AtlasImage;
+        typedef std::vector<AtlasImage> AtlasImageList;
+
+        /**
+        * Packs the given images into as few atlas pages (one texture each) as fit, and adds every image under its name as
+        * a region of its page (see Texture::getRegion). Pages are added as "<atlasName>#<page index>".
+        * Drawing many sprites from the same page only binds one texture, and with Window::batch costs one draw call.
+        * Images already added under their name or URI are skipped. Images larger than a page (which is never larger than the
+        * renderer's maximum texture size) are added as textures of their own instead, outside the atlas.
+        * Returns the number of pages created.
+        */
+        int addAtlas(std::string atlasName, const AtlasImageList &images, WindowHnd win, int pageSize = DEFAULT_ATLAS_PAGE_SIZE);
+
+        /**
+        * Adds a texture and returns its handle immediately, while the image is decoded on the JobPool. The decoded image is
+        * uploaded by uploadPending, on the render thread, and the placeholder (see setPlaceholder) is drawn until then.
+        * Like addTexture, returns an invalid handle if the name or URI is already in use, and is called from the main thread.
+        */
+        TextureHnd addTextureAsync(std::string name, std::string uri, WindowHnd win, bool allowOverwrite = false);
+
+        /**
+        * Names the texture (already added) drawn in place of textures still loading asynchronously. Only applies to later
+        * loads. An empty name draws nothing until they are ready.
+        */
+        void setPlaceholder(std::string name);
+
+        /**
+        * Uploads decoded images to their textures, stopping once the frame's upload budget is spent (see setUploadBudget).
+        * At least one image is uploaded per call, however large. Called once a frame by the main loop, on the render thread.
+        * Returns the number of textures uploaded.
+        */
+        int uploadPending();
+
+        /**
+        * Sets the number of bytes of decoded image uploadPending uploads per call. 0 (zero) uploads everything decoded.
+        */
+        void setUploadBudget(size_t bytes);
+
+        /**
+        * Returns the number of asynchronous loads that are decoding or waiting for upload.
+        */
+        int pendingLoads();
+
+        static const size_t DEFAULT_UPLOAD_BUDGET = 8*1024*1024;
+        static const int DEFAULT_ATLAS_PAGE_SIZE = 2048;
+        /** Transparent pixels left around each image, so filtering never samples its neighbours. */
+        static const int ATLAS_PADDING = 1;
+
         static TextureManager* getInstance();
 
     private:
         static TextureManager* mInstance;
 
+        struct sDecodedImage{
+            std::weak_ptr<Texture> texture;
+            SDL_SurfacePtr surface;
+        };
+        typedef std::shared_ptr<sDecodedImage> DecodedImagePtr;
+
+        std::string mPlaceholderName;
+        size_t mUploadBudget;
+        int mPendingLoads;
+        std::deque<DecodedImagePtr> mDecoded;
+        boost::mutex mDecodedProtection;
+
         TextureManager();
+
+        /** Runs on the JobPool. Decodes the image and queues it for upload. */
+        void DecodeImage(std::string uri, std::weak_ptr<Texture> texture);
 };
 
 
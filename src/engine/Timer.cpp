@@ -110,6 +110,31 @@ int Timer::steps(){
     return 0;
 }
 
+int Timer::steps(int maxSteps){
+    int count = steps();
+    if (maxSteps >= 0 && count > maxSteps){
+        count = maxSteps;
+    }
+    return count;
+}
+
+float Timer::stepAlpha(){
+    if (mStepTime > 0){
+        return static_cast<float>(mAccumulatedTicks)/static_cast<float>(mStepTime);
+    }
+    return 0.0f;
+}
+
+int Timer::ticksToNextStep(){
+    if (mStartTicks > 0 && mPausedTicks == 0 && mStepTime > 0){
+        int pending = mAccumulatedTicks + (ticks() - mStepTicks);
+        if (pending < mStepTime){
+            return mStepTime - pending;
+        }
+    }
+    return 0;
+}
+
 int Timer::getDefinedStepTime(){
     return mStepTime;
 }
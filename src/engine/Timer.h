@@ -48,6 +48,22 @@ class Timer
         int ticks();
         int steps();
 
+        /**
+        * Same as steps(), but never returns more than maxSteps. Any time beyond that is dropped rather than carried over, so a
+        * long stall doesn't turn into a burst of catch-up steps.
+        */
+        int steps(int maxSteps);
+
+        /**
+        * Returns how far (0.0 to 1.0) the time accumulated since the last whole step is towards the next one.
+        */
+        float stepAlpha();
+
+        /**
+        * Returns the number of milliseconds until steps() next returns a step, or 0 (zero) if one is already due.
+        */
+        int ticksToNextStep();
+
         int getDefinedStepTime();
         bool started();
         bool paused();
@@ -29,12 +29,37 @@
 namespace engine{
 
 
+/**
+* Dependency tags used by IUpdateable::updateReads and updateWrites. Game code is free to define its own tags from
+* UpdateTag_User upward.
+*/
+enum UpdateTag {
+    UpdateTag_None = 0,
+    UpdateTag_Events = 1 << 0,  /**< Queues or flushes EventManager events. */
+    UpdateTag_Textures = 1 << 1, /**< Creates, changes or releases textures (implies the renderer). */
+    UpdateTag_Writer = 1 << 2,  /**< Uses the shared Writer, including its pen color. */
+    UpdateTag_User = 1 << 8
+};
+
 /**
 * Interface class for all objects that update via the system's recurring loop.
 */
 class IUpdateable{
 public:
     virtual void update()=0;
+
+    /**
+    * Return true if update() may run on a worker thread, alongside other updateables. Defaults to false, which keeps
+    * update() on the main thread and in stack order with everything around it.
+    */
+    virtual bool parallelUpdate(){return false;}
+
+    /**
+    * Dependency tags (one bit per tag, see UpdateTag) of the data update() reads and writes. Two parallel updateables only run
+    * at the same time if neither writes a tag the other reads or writes. Only consulted when parallelUpdate() returns true.
+    */
+    virtual unsigned int updateReads(){return 0;}
+    virtual unsigned int updateWrites(){return 0;}
 protected:
     IUpdateable(){}
 };
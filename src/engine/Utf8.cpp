@@ -0,0 +1,96 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "Utf8.h"
+
+
+namespace engine{
+
+
+Uint32 Utf8::Decode(const std::string &text, size_t &pos){
+    Uint8 lead = static_cast<Uint8>(text[pos]);
+    if (lead < 0x80){
+        pos++;
+        return lead;
+    }
+
+    size_t length;
+    Uint32 ch;
+    Uint32 minimum;
+    if ((lead & 0xE0) == 0xC0){
+        length = 2;
+        ch = lead & 0x1F;
+        minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0){
+        length = 3;
+        ch = lead & 0x0F;
+        minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0){
+        length = 4;
+        ch = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        pos++;
+        return REPLACEMENT;
+    }
+
+    if (pos + length > text.size()){
+        pos++;
+        return REPLACEMENT;
+    }
+    for (size_t i = 1; i < length; i++){
+        Uint8 next = static_cast<Uint8>(text[pos + i]);
+        if ((next & 0xC0) != 0x80){
+            pos++;
+            return REPLACEMENT;
+        }
+        ch = (ch << 6) | (next & 0x3F);
+    }
+    if (ch < minimum || ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF)){
+        pos++;
+        return REPLACEMENT;
+    }
+    pos += length;
+    return ch;
+}
+
+void Utf8::Decode(const std::string &text, std::vector<Uint32> &chars){
+    chars.clear();
+    chars.reserve(text.size());
+    size_t pos = 0;
+    while (pos < text.size()){
+        chars.push_back(Decode(text, pos));
+    }
+}
+
+size_t Utf8::Next(const std::string &text, size_t pos){
+    if (pos >= text.size()){
+        return text.size();
+    }
+    Decode(text, pos);
+    return pos;
+}
+
+
+} // End namespace "engine"
@@ -0,0 +1,67 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+
+namespace engine{
+
+
+/** \class
+* \brief Decoding of UTF-8 strings, the encoding all text handed to the Writer is in.
+*
+* Malformed sequences (stray continuation bytes, truncated or overlong sequences, surrogates) decode to REPLACEMENT,
+* one byte at a time, so broken text still draws, and still breaks between characters, instead of failing.
+*/
+class Utf8
+{
+    public:
+        static const Uint32 REPLACEMENT = 0xFFFD;
+
+        /**
+        * Decodes the character starting at pos and moves pos past it. pos must be less than the text's size.
+        */
+        static Uint32 Decode(const std::string &text, size_t &pos);
+
+        /**
+        * Decodes the whole text into code points, replacing what chars held.
+        */
+        static void Decode(const std::string &text, std::vector<Uint32> &chars);
+
+        /**
+        * Returns the offset of the character after the one starting at pos (the text's size at the end).
+        */
+        static size_t Next(const std::string &text, size_t pos);
+};
+
+
+} // End namespace "engine"
+
+#endif // UTF8_H
@@ -0,0 +1,144 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "VirtualFileSystem.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+
+namespace engine{
+
+
+VirtualFileSystemPtr VirtualFileSystem::mInstance = VirtualFileSystemPtr();
+
+VirtualFileSystem::VirtualFileSystem() : mLooseFiles(true){}
+
+VirtualFileSystemPtr VirtualFileSystem::getInstance(){
+    if (mInstance.get() == 0){
+        mInstance = VirtualFileSystemPtr(new VirtualFileSystem());
+    }
+    return mInstance;
+}
+
+void VirtualFileSystem::mount(const std::string &archivePath){
+    ArchivePtr archive = ArchivePtr(new Archive(archivePath));
+    boost::mutex::scoped_lock lock(mVFSProtection);
+    mArchives.push_back(archive);
+}
+
+void VirtualFileSystem::setLooseFiles(bool enable){
+    boost::mutex::scoped_lock lock(mVFSProtection);
+    mLooseFiles = enable;
+}
+
+bool VirtualFileSystem::exists(const std::string &path){
+    if (path == ""){
+        return false;
+    }
+    const Archive::sEntry* entry = nullptr;
+    if (FindEntry(path, entry).get() != 0){
+        return true;
+    }
+    bool loose = false;
+    {
+        boost::mutex::scoped_lock lock(mVFSProtection);
+        loose = mLooseFiles;
+    }
+    if (loose){
+        struct stat info;
+        return stat(path.c_str(), &info) == 0;
+    }
+    return false;
+}
+
+bool VirtualFileSystem::read(const std::string &path, FileData &file){
+    file = FileData();
+    if (path == ""){
+        return false;
+    }
+
+    const Archive::sEntry* entry = nullptr;
+    ArchivePtr archive = FindEntry(path, entry);
+    if (archive.get() != 0){
+        file.archive = archive;
+        if (entry->flags & Archive::Entry_Deflate){
+            file.buffer = std::shared_ptr<std::vector<char> >(new std::vector<char>());
+            if (!archive->inflate(*entry, *file.buffer)){
+                file = FileData();
+                return false;
+            }
+            file.data = file.buffer->empty() ? nullptr : &(*file.buffer)[0];
+            file.size = file.buffer->size();
+        } else {
+            file.data = archive->storedData(*entry);
+            file.size = static_cast<size_t>(entry->size);
+        }
+        return true;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mVFSProtection);
+        if (!mLooseFiles){
+            return false;
+        }
+    }
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr){
+        return false;
+    }
+    file.buffer = std::shared_ptr<std::vector<char> >(new std::vector<char>());
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    file.buffer->resize(size > 0 ? static_cast<size_t>(size) : 0);
+    bool ok = file.buffer->empty() || fread(&(*file.buffer)[0], 1, file.buffer->size(), f) == file.buffer->size();
+    fclose(f);
+    if (!ok){
+        file = FileData();
+        return false;
+    }
+    file.data = file.buffer->empty() ? nullptr : &(*file.buffer)[0];
+    file.size = file.buffer->size();
+    return true;
+}
+
+
+// PRIVATE
+
+ArchivePtr VirtualFileSystem::FindEntry(const std::string &path, const Archive::sEntry* &entry){
+    boost::mutex::scoped_lock lock(mVFSProtection);
+    for (size_t i = mArchives.size(); i > 0; i--){
+        entry = mArchives[i-1]->find(path);
+        if (entry != nullptr){
+            return mArchives[i-1];
+        }
+    }
+    return ArchivePtr();
+}
+
+
+} // End namespace "engine"
@@ -0,0 +1,117 @@
+#ifndef VIRTUALFILESYSTEM_H
+#define VIRTUALFILESYSTEM_H
+
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <boost/thread/mutex.hpp>
+
+#include <SDL2/SDL.h>
+
+#include "Archive.h"
+
+
+namespace engine{
+
+class VirtualFileSystem;
+/** \typedef
+* \brief std::shared_ptr<VirtualFileSystem>
+*/
+typedef std::shared_ptr<VirtualFileSystem> VirtualFileSystemPtr;
+
+
+/** \struct
+* \brief The contents of a file read through the VirtualFileSystem.
+*
+* data points either straight into a mounted archive's mapping or into buffer. Either way, the memory stays valid for as
+* long as this object (or a copy of it) lives.
+*/
+struct FileData{
+    const char* data;
+    size_t size;
+    std::shared_ptr<std::vector<char> > buffer;
+    ArchivePtr archive;
+
+    FileData() : data(nullptr), size(0){}
+
+    /**
+    * Returns a read-only SDL_RWops over the data, for SDL_image and SDL_ttf. The FileData must outlive the SDL_RWops.
+    */
+    SDL_RWops* rwops() const{
+        return SDL_RWFromConstMem(data, static_cast<int>(size));
+    }
+};
+
+
+/** \class
+* \brief [SINGLETON] Resolves asset paths against mounted archives, then the loose file system.
+*
+* Archives mounted later take precedence over those mounted earlier, and any archive over loose files. Looking a path up
+* in an archive is a hash lookup, so assets packed into archives never cost a file system call to find or open.
+* This class is thread-safe.
+*/
+class VirtualFileSystem
+{
+    public:
+        /**
+        * Mounts the archive at the given path. Throws a runtime_error if it can't be opened.
+        */
+        void mount(const std::string &archivePath);
+
+        /**
+        * Enables or disables falling back to loose files for paths no mounted archive holds. Enabled by default.
+        */
+        void setLooseFiles(bool enable);
+
+        bool exists(const std::string &path);
+
+        /**
+        * Reads the file at the given path into file. Stored archive entries are not copied. Returns false if the file
+        * doesn't exist or can't be read.
+        */
+        bool read(const std::string &path, FileData &file);
+
+        static VirtualFileSystemPtr getInstance();
+
+    private:
+        static VirtualFileSystemPtr mInstance;
+
+        std::vector<ArchivePtr> mArchives;
+        bool mLooseFiles;
+        boost::mutex mVFSProtection;
+
+        VirtualFileSystem();
+
+        /** Returns the archive holding the path, filling entry, or an empty pointer. */
+        ArchivePtr FindEntry(const std::string &path, const Archive::sEntry* &entry);
+};
+
+
+} // End namespace "engine"
+
+#endif // VIRTUALFILESYSTEM_H
@@ -22,7 +22,12 @@
 * THE SOFTWARE.
 */
 
+#include <cmath>
+#include <algorithm>
+
 #include "Window.h"
+#include "Texture.h"
+#include "Profiler.h"
 
 
 namespace engine{
@@ -44,11 +49,19 @@ namespace engine{
         setPenColor(0, 0, 0, 255);
         setBucketColor(0, 0, 0, 255);
         mPenThickness = 1;
+        mRenderColorKnown = false;
+        mCameraX = mCameraY = 0;
+        SDL_AddEventWatch(&Window::RenderResetWatch, this);
+    }
+
+    Window::~Window(){
+        SDL_DelEventWatch(&Window::RenderResetWatch, this);
     }
 
     void Window::render(SDL_Texture *tex, const SDL_Rect *src, const SDL_Rect *dst){
         SDL_Renderer *r = mRenderer.get();
         if (r != 0){
+            flushBatch();
             SDL_RenderCopy(r, tex, src, dst);
         }
     }
@@ -56,10 +69,341 @@ namespace engine{
     void Window::render(SDL_Texture *tex, const SDL_Rect* src, const SDL_Rect* dst, const double& angle, const SDL_Point* center, const SDL_RendererFlip& flip){
         SDL_Renderer *r = mRenderer.get();
         if (r != 0){
+            flushBatch();
             SDL_RenderCopyEx(r, tex, src, dst, angle, center, flip);
         }
     }
 
+    void Window::batch(SDL_Texture *tex, const SDL_Rect* src, const SDL_Rect* dst, const double& angle, const SDL_Point* center, const SDL_RendererFlip& flip, const SDL_Color* color){
+        if (tex == nullptr || dst == nullptr){
+            return;
+        }
+        FlushShapes();
+        sBatchQuad quad;
+        quad.texture = tex;
+        SDL_GetTextureBlendMode(tex, &quad.blendMode);
+        quad.fullSource = (src == nullptr);
+        if (src != nullptr){
+            quad.src = *src;
+        }
+        quad.dst = *dst;
+        quad.angle = angle;
+        if (center != nullptr){
+            quad.center.x = static_cast<float>(center->x);
+            quad.center.y = static_cast<float>(center->y);
+        } else {
+            quad.center.x = dst->w*0.5f;
+            quad.center.y = dst->h*0.5f;
+        }
+        quad.flip = flip;
+        if (color != nullptr){
+            quad.color = *color;
+        } else {
+            quad.color.r = quad.color.g = quad.color.b = quad.color.a = 255;
+        }
+        mBatch.push_back(quad);
+    }
+
+    void Window::flushBatch(){
+        // Queuing either kind flushes the other, so at most one of them holds anything.
+        FlushShapes();
+        SDL_Renderer *r = mRenderer.get();
+        if (mBatch.empty() || r == 0){
+            return;
+        }
+        ENGINE_PROFILE_ZONE("Window::flushBatch");
+
+        // Stable, so quads of the same texture are still drawn in the order they were queued.
+        std::stable_sort(mBatch.begin(), mBatch.end(), [](const sBatchQuad &a, const sBatchQuad &b){
+            if (a.blendMode != b.blendMode){
+                return a.blendMode < b.blendMode;
+            }
+            return a.texture < b.texture;
+        });
+
+        size_t first = 0;
+        for (size_t i = 1; i <= mBatch.size(); i++){
+            if (i == mBatch.size() || mBatch[i].texture != mBatch[first].texture){
+                DrawBatchRun(r, first, i);
+                first = i;
+            }
+        }
+        mBatch.clear();
+    }
+
+    void Window::addLayer(const std::string &name, int depth, LayerPainter painter, const SDL_Rect* area){
+        removeLayer(name);
+
+        sLayer layer;
+        layer.name = name;
+        layer.depth = depth;
+        layer.painter = painter;
+        if (area != nullptr){
+            layer.area = *area;
+        } else {
+            layer.area.x = layer.area.y = 0;
+            ScreenSize(&layer.area.w, &layer.area.h);
+        }
+        try{
+            layer.target = std::shared_ptr<Texture>(new Texture(WindowHnd(shared_from_this()), layer.area.w, layer.area.h, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET));
+        } catch (std::runtime_error e){
+            throw e;
+        }
+        layer.target->setBlendMode(SDL_BLENDMODE_BLEND);
+        layer.dirty = true;
+        layer.dirtyRegion.x = layer.dirtyRegion.y = 0;
+        layer.dirtyRegion.w = layer.area.w;
+        layer.dirtyRegion.h = layer.area.h;
+
+        std::vector<sLayer>::iterator pos = mLayers.begin();
+        while (pos != mLayers.end() && pos->depth <= depth){
+            pos++;
+        }
+        mLayers.insert(pos, layer);
+    }
+
+    void Window::removeLayer(const std::string &name){
+        for (std::vector<sLayer>::iterator layer = mLayers.begin(); layer != mLayers.end(); layer++){
+            if (layer->name == name){
+                mLayers.erase(layer);
+                return;
+            }
+        }
+    }
+
+    bool Window::hasLayer(const std::string &name){
+        for (size_t i = 0; i < mLayers.size(); i++){
+            if (mLayers[i].name == name){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Window::markLayerDirty(const std::string &name, const SDL_Rect* region){
+        for (size_t i = 0; i < mLayers.size(); i++){
+            sLayer &layer = mLayers[i];
+            if (layer.name != name){
+                continue;
+            }
+            SDL_Rect bounds = {0, 0, layer.area.w, layer.area.h};
+            SDL_Rect marked;
+            if (region == nullptr){
+                marked = bounds;
+            } else if (!SDL_IntersectRect(region, &bounds, &marked)){
+                return;
+            }
+            if (layer.dirty){
+                SDL_UnionRect(&layer.dirtyRegion, &marked, &layer.dirtyRegion);
+            } else {
+                layer.dirtyRegion = marked;
+                layer.dirty = true;
+            }
+            return;
+        }
+    }
+
+    void Window::markAllLayersDirty(){
+        for (size_t i = 0; i < mLayers.size(); i++){
+            sLayer &layer = mLayers[i];
+            layer.dirtyRegion.x = layer.dirtyRegion.y = 0;
+            layer.dirtyRegion.w = layer.area.w;
+            layer.dirtyRegion.h = layer.area.h;
+            layer.dirty = true;
+        }
+    }
+
+    void Window::compositeLayers(){
+        ENGINE_PROFILE_ZONE("Window::compositeLayers");
+        SDL_Rect screen = {0, 0, 0, 0};
+        ScreenSize(&screen.w, &screen.h);
+        for (size_t i = 0; i < mLayers.size(); i++){
+            sLayer &layer = mLayers[i];
+            if (!SDL_HasIntersection(&layer.area, &screen)){
+                continue;
+            }
+            if (layer.dirty){
+                RedrawLayer(layer);
+            }
+            SDL_Rect src = {0, 0, layer.area.w, layer.area.h};
+            layer.target->batch(&src, &layer.area);
+            // Layers overlap, and the batch may reorder different textures, so each composite is its own flush.
+            flushBatch();
+        }
+    }
+
+    void Window::setCamera(int x, int y){
+        mCameraX = x;
+        mCameraY = y;
+    }
+
+    void Window::getCamera(int *x, int *y){
+        if (x != nullptr){*x = mCameraX;}
+        if (y != nullptr){*y = mCameraY;}
+    }
+
+    void Window::getViewport(SDL_Rect *view){
+        view->x = mCameraX;
+        view->y = mCameraY;
+        ScreenSize(&view->w, &view->h);
+    }
+
+    bool Window::isVisible(const SDL_Rect &world){
+        SDL_Rect view;
+        getViewport(&view);
+        return SDL_HasIntersection(&world, &view) == SDL_TRUE;
+    }
+
+    void Window::worldToScreen(const SDL_Rect &world, SDL_Rect &screen){
+        screen.x = world.x - mCameraX;
+        screen.y = world.y - mCameraY;
+        screen.w = world.w;
+        screen.h = world.h;
+    }
+
+    void Window::recordTexture(int layer, SDL_Texture *tex, const SDL_Rect* src, const SDL_Rect* dst, const SDL_Color* color, const double& angle, const SDL_Point* center, const SDL_RendererFlip& flip){
+        if (tex == nullptr || dst == nullptr){
+            return;
+        }
+        // Ids past what the key holds share the last one; their commands still draw, just without grouping.
+        std::unordered_map<SDL_Texture*, Uint32>::iterator id = mCommandTextureIds.find(tex);
+        if (id == mCommandTextureIds.end()){
+            Uint32 next = std::min(static_cast<Uint32>(mCommandTextureIds.size()) + 1, static_cast<Uint32>(0xFFF));
+            id = mCommandTextureIds.insert(std::pair<SDL_Texture*, Uint32>(tex, next)).first;
+        }
+
+        sCommand cmd;
+        cmd.type = Command_Texture;
+        cmd.texture = tex;
+        SDL_GetTextureBlendMode(tex, &cmd.blendMode);
+        cmd.fullSource = (src == nullptr);
+        if (src != nullptr){
+            cmd.src = *src;
+        }
+        cmd.dst = *dst;
+        cmd.angle = angle;
+        cmd.hasCenter = (center != nullptr);
+        if (center != nullptr){
+            cmd.center = *center;
+        }
+        cmd.flip = flip;
+        if (color != nullptr){
+            cmd.color = *color;
+        } else {
+            cmd.color.r = cmd.color.g = cmd.color.b = cmd.color.a = 255;
+        }
+        cmd.key = CommandKey(layer, cmd.blendMode, id->second, cmd.color);
+        cmd.sequence = static_cast<Uint32>(mCommands.size());
+        mCommands.push_back(cmd);
+    }
+
+    void Window::recordFillRect(int layer, const SDL_Rect &rect, const SDL_Color &color){
+        RecordPrimitive(layer, Command_FillRect, rect, color);
+    }
+
+    void Window::recordRect(int layer, const SDL_Rect &rect, const SDL_Color &color){
+        RecordPrimitive(layer, Command_Rect, rect, color);
+    }
+
+    void Window::recordLine(int layer, int x1, int y1, int x2, int y2, const SDL_Color &color){
+        SDL_Rect line = {x1, y1, x2, y2};
+        RecordPrimitive(layer, Command_Line, line, color);
+    }
+
+    void Window::recordPoint(int layer, int x, int y, const SDL_Color &color){
+        SDL_Rect point = {x, y, 0, 0};
+        RecordPrimitive(layer, Command_Point, point, color);
+    }
+
+    size_t Window::commandCount(){
+        return mCommands.size();
+    }
+
+    void Window::submitCommands(){
+        SDL_Renderer *r = mRenderer.get();
+        if (mCommands.empty() || r == 0){
+            mCommands.clear();
+            mCommandTextureIds.clear();
+            return;
+        }
+        ENGINE_PROFILE_ZONE("Window::submitCommands");
+        flushBatch();
+
+        std::sort(mCommands.begin(), mCommands.end(), [](const sCommand &a, const sCommand &b){
+            if (a.key != b.key){
+                return a.key < b.key;
+            }
+            return a.sequence < b.sequence;
+        });
+
+        SDL_BlendMode oldBlendMode;
+        SDL_GetRenderDrawBlendMode(r, &oldBlendMode);
+        SDL_BlendMode drawBlendMode = oldBlendMode;
+
+        size_t i = 0;
+        while (i < mCommands.size()){
+            const sCommand &cmd = mCommands[i];
+            if (i > 0 && (mCommands[i-1].key >> 48) != (cmd.key >> 48)){
+                // New layer; what's queued of the last one goes under it.
+                flushBatch();
+            }
+
+            if (cmd.type == Command_Texture){
+                batch(cmd.texture, cmd.fullSource ? nullptr : &cmd.src, &cmd.dst, cmd.angle, cmd.hasCenter ? &cmd.center : nullptr, cmd.flip, &cmd.color);
+                i++;
+                continue;
+            }
+
+            flushBatch();
+            if (cmd.blendMode != drawBlendMode){
+                SDL_SetRenderDrawBlendMode(r, cmd.blendMode);
+                drawBlendMode = cmd.blendMode;
+            }
+            setRenderColor(&cmd.color);
+
+            // Same key and type means same layer, blend mode and color, so the whole run is drawn with one call.
+            size_t last = i + 1;
+            while (last < mCommands.size() && mCommands[last].key == cmd.key && mCommands[last].type == cmd.type){
+                last++;
+            }
+            switch (cmd.type){
+            case Command_FillRect:
+            case Command_Rect:
+                mCommandRects.clear();
+                for (size_t j = i; j < last; j++){
+                    mCommandRects.push_back(mCommands[j].dst);
+                }
+                if (cmd.type == Command_FillRect){
+                    SDL_RenderFillRects(r, &mCommandRects[0], static_cast<int>(mCommandRects.size()));
+                } else {
+                    SDL_RenderDrawRects(r, &mCommandRects[0], static_cast<int>(mCommandRects.size()));
+                }
+                break;
+            case Command_Point:
+                mCommandPoints.clear();
+                for (size_t j = i; j < last; j++){
+                    SDL_Point p = {mCommands[j].dst.x, mCommands[j].dst.y};
+                    mCommandPoints.push_back(p);
+                }
+                SDL_RenderDrawPoints(r, &mCommandPoints[0], static_cast<int>(mCommandPoints.size()));
+                break;
+            default:
+                for (size_t j = i; j < last; j++){
+                    const SDL_Rect &line = mCommands[j].dst;
+                    SDL_RenderDrawLine(r, line.x, line.y, line.w, line.h);
+                }
+            }
+            i = last;
+        }
+        flushBatch();
+
+        if (drawBlendMode != oldBlendMode){
+            SDL_SetRenderDrawBlendMode(r, oldBlendMode);
+        }
+        mCommands.clear();
+        mCommandTextureIds.clear();
+    }
+
     void Window::setLogicalRendererSize(int w, int h){
         SDL_RenderSetLogicalSize(mRenderer.get(), w, h);
     }
@@ -158,66 +502,121 @@ namespace engine{
         return mPenThickness;
     }
 
-    void Window::setRenderColor(SDL_Color *c){
+    void Window::setRenderColor(const SDL_Color *c){
         SDL_Renderer* r = mRenderer.get();
         if (r != 0){
+            if (mRenderColorKnown && mRenderColor.r == c->r && mRenderColor.g == c->g && mRenderColor.b == c->b && mRenderColor.a == c->a){
+                return;
+            }
             SDL_SetRenderDrawColor(r, c->r, c->g, c->b, c->a);
+            mRenderColor = *c;
+            mRenderColorKnown = true;
         }
     }
 
+    void Window::forgetRenderColor(){
+        mRenderColorKnown = false;
+    }
+
     void Window::drawLine(int x1, int y1, int x2, int y2){
-        SDL_Renderer* r = mRenderer.get();
-        if (r != 0){
-            setRenderColor(&mPenColor);
-            SDL_RenderDrawLine(r, x1, y1, x2, y2);
+        if (mRenderer.get() != 0){
+            AddSegment(x1 + 0.5f, y1 + 0.5f, x2 + 0.5f, y2 + 0.5f, static_cast<float>(std::max(mPenThickness, 1)), mPenColor);
         }
     }
 
     void Window::drawLines(const SDL_Point* points, int count){
-        SDL_Renderer* r = mRenderer.get();
-        if (r != 0){
-            setRenderColor(&mPenColor);
-            SDL_RenderDrawLines(r, points, count);
+        if (mRenderer.get() != 0){
+            float thickness = static_cast<float>(std::max(mPenThickness, 1));
+            for (int i = 1; i < count; i++){
+                AddSegment(points[i-1].x + 0.5f, points[i-1].y + 0.5f, points[i].x + 0.5f, points[i].y + 0.5f, thickness, mPenColor);
+            }
         }
     }
 
     void Window::drawRect(int x, int y, int w, int h, bool hollow){
-        SDL_Renderer* r = mRenderer.get();
-        if (r != 0){
-            SDL_Rect rect;
-            rect.x = x;
-            rect.y = y;
-            rect.w = w;
-            rect.h = h;
-            if (!hollow){
-                SDL_RenderFillRect(r, &rect);
-            }
-            if (mPenThickness > 0){
-                SDL_RenderDrawRect(r, &rect);
+        SDL_Rect rect;
+        rect.x = x;
+        rect.y = y;
+        rect.w = w;
+        rect.h = h;
+        drawRect(&rect, hollow);
+    }
+
+    void Window::drawRect(const SDL_Rect* rect, bool hollow){
+        drawRects(rect, 1, hollow);
+    }
+
+    void Window::drawRects(const SDL_Rect* rects, int count, bool hollow){
+        if (mRenderer.get() != 0){
+            for (int i = 0; i < count; i++){
+                if (!hollow){
+                    AddRectFill(rects[i], mBucketColor);
+                }
+                if (mPenThickness > 0){
+                    AddRectOutline(rects[i], mPenThickness, mPenColor);
+                }
             }
         }
     }
 
-    void Window::drawRect(const SDL_Rect* rect, bool hollow){
-        SDL_Renderer* r = mRenderer.get();
-        if (r != 0){
-            if (!hollow){
-                SDL_RenderFillRect(r, rect);
+    void Window::drawCircle(int x, int y, int radius, bool hollow){
+        if (mRenderer.get() == 0 || radius <= 0){
+            return;
+        }
+        // Enough segments that no edge is longer than about 4 pixels.
+        int segments = std::max(12, std::min(256, static_cast<int>(2.0*M_PI*radius/4.0)));
+        float cx = x + 0.5f;
+        float cy = y + 0.5f;
+        float outer = static_cast<float>(radius);
+        float inner = std::max(0.0f, outer - mPenThickness);
+
+        std::vector<SDL_FPoint> rim(segments);
+        for (int i = 0; i < segments; i++){
+            double a = 2.0*M_PI*i/segments;
+            rim[i].x = static_cast<float>(std::cos(a));
+            rim[i].y = static_cast<float>(std::sin(a));
+        }
+
+        if (!hollow){
+            std::vector<SDL_FPoint> fill(segments);
+            for (int i = 0; i < segments; i++){
+                fill[i].x = cx + rim[i].x*outer;
+                fill[i].y = cy + rim[i].y*outer;
             }
-            if (mPenThickness > 0){
-                SDL_RenderDrawRect(r, rect);
+            AddConvex(&fill[0], segments, mBucketColor);
+        }
+        if (mPenThickness > 0){
+            for (int i = 0; i < segments; i++){
+                const SDL_FPoint &a = rim[i];
+                const SDL_FPoint &b = rim[(i + 1) % segments];
+                SDL_FPoint quad[4] = {
+                    {cx + a.x*outer, cy + a.y*outer},
+                    {cx + b.x*outer, cy + b.y*outer},
+                    {cx + b.x*inner, cy + b.y*inner},
+                    {cx + a.x*inner, cy + a.y*inner}
+                };
+                AddConvex(quad, 4, mPenColor);
             }
         }
     }
 
-    void Window::drawRects(const SDL_Rect* rects, int count, bool hollow){
-        SDL_Renderer* r = mRenderer.get();
-        if (r != 0){
-            if (!hollow){
-                SDL_RenderFillRects(r, rects, count);
+    void Window::drawPolygon(const SDL_Point* points, int count, bool hollow){
+        if (mRenderer.get() == 0 || count < 2){
+            return;
+        }
+        if (!hollow && count > 2){
+            std::vector<SDL_FPoint> fill(count);
+            for (int i = 0; i < count; i++){
+                fill[i].x = points[i].x + 0.5f;
+                fill[i].y = points[i].y + 0.5f;
             }
-            if (mPenThickness > 0){
-                SDL_RenderDrawRects(r, rects, count);
+            AddConvex(&fill[0], count, mBucketColor);
+        }
+        if (mPenThickness > 0){
+            for (int i = 0; i < count; i++){
+                const SDL_Point &a = points[i];
+                const SDL_Point &b = points[(i + 1) % count];
+                AddSegment(a.x + 0.5f, a.y + 0.5f, b.x + 0.5f, b.y + 0.5f, static_cast<float>(mPenThickness), mPenColor);
             }
         }
     }
@@ -225,6 +624,7 @@ namespace engine{
     void Window::drawPoint(int x, int y){
         SDL_Renderer* r = mRenderer.get();
         if (r != 0){
+            flushBatch();
             setRenderColor(&mPenColor);
             SDL_RenderDrawPoint(r, x, y);
         }
@@ -233,6 +633,7 @@ namespace engine{
     void Window::drawPoint(const SDL_Point* point){
         SDL_Renderer* r = mRenderer.get();
         if (r != 0){
+            flushBatch();
             setRenderColor(&mPenColor);
             SDL_RenderDrawPoint(r, point->x, point->y);
         }
@@ -241,6 +642,7 @@ namespace engine{
     void Window::drawPoints(const SDL_Point* points, int count){
         SDL_Renderer* r = mRenderer.get();
         if (r != 0){
+            flushBatch();
             setRenderColor(&mPenColor);
             SDL_RenderDrawPoints(r, points, count);
         }
@@ -249,9 +651,10 @@ namespace engine{
     void Window::setRenderTarget(SDL_Texture *target){
         SDL_Renderer* r = mRenderer.get();
         if (r != 0){
+            flushBatch();
             SDL_RendererInfo rinfo;
             SDL_GetRendererInfo(r, &rinfo);
-            if (rinfo.flags & SDL_RENDERER_TARGETTEXTURE != 0){
+            if ((rinfo.flags & SDL_RENDERER_TARGETTEXTURE) != 0){
                 SDL_SetRenderTarget(r, target);
             } else {
                 throw std::runtime_error("Render to Texture not supported.");
@@ -267,12 +670,42 @@ namespace engine{
         return nullptr;
     }
 
+    void Window::setClipRect(const SDL_Rect* rect){
+        SDL_Renderer* r = mRenderer.get();
+        if (r != 0){
+            flushBatch();
+            SDL_RenderSetClipRect(r, rect);
+        }
+    }
+
+    void Window::pushClipRect(const SDL_Rect &rect){
+        SDL_Rect clip = rect;
+        if (!mClipStack.empty() && !SDL_IntersectRect(&rect, &mClipStack.back(), &clip)){
+            // Nothing of the rectangle is inside the current clip, so nothing gets drawn.
+            clip.w = clip.h = 0;
+        }
+        mClipStack.push_back(clip);
+        setClipRect(&clip);
+    }
+
+    void Window::popClipRect(){
+        if (mClipStack.empty()){
+            return;
+        }
+        mClipStack.pop_back();
+        setClipRect(mClipStack.empty() ? nullptr : &mClipStack.back());
+    }
+
     void Window::clear(){
+        flushBatch();
         setRenderColor(&mClearColor);
         SDL_RenderClear(mRenderer.get());
     }
 
     void Window::present(){
+        ENGINE_PROFILE_ZONE("Window::present");
+        submitCommands();
+        flushBatch();
         SDL_RenderPresent(mRenderer.get());
     }
 
@@ -360,6 +793,154 @@ namespace engine{
     // ---------------------
 
 
+    void Window::FlushShapes(){
+        SDL_Renderer *r = mRenderer.get();
+        if (mShapeIndices.empty() || r == 0){
+            return;
+        }
+        ENGINE_PROFILE_ZONE("Window::FlushShapes");
+        SDL_RenderGeometry(r, nullptr, &mShapeVertices[0], static_cast<int>(mShapeVertices.size()), &mShapeIndices[0], static_cast<int>(mShapeIndices.size()));
+        mShapeVertices.clear();
+        mShapeIndices.clear();
+    }
+
+    void Window::AddConvex(const SDL_FPoint* points, int count, const SDL_Color &color){
+        if (count < 3){
+            return;
+        }
+        if (!mBatch.empty()){
+            flushBatch();
+        }
+        int base = static_cast<int>(mShapeVertices.size());
+        for (int i = 0; i < count; i++){
+            SDL_Vertex v;
+            v.position = points[i];
+            v.color = color;
+            v.tex_coord.x = v.tex_coord.y = 0.0f;
+            mShapeVertices.push_back(v);
+        }
+        // A fan from the first point covers any convex polygon.
+        for (int i = 1; i < count - 1; i++){
+            mShapeIndices.push_back(base);
+            mShapeIndices.push_back(base + i);
+            mShapeIndices.push_back(base + i + 1);
+        }
+    }
+
+    void Window::AddSegment(float x1, float y1, float x2, float y2, float thickness, const SDL_Color &color){
+        float dx = x2 - x1;
+        float dy = y2 - y1;
+        float length = std::sqrt(dx*dx + dy*dy);
+        float half = thickness*0.5f;
+        if (length > 0.0f){
+            dx = dx/length*half;
+            dy = dy/length*half;
+        } else {
+            // A single point; a square of the pen's thickness.
+            dx = half;
+            dy = 0.0f;
+        }
+        // Square ends: the quad reaches half the thickness past each end point, so segments meet without gaps.
+        SDL_FPoint quad[4] = {
+            {x1 - dx + dy, y1 - dy - dx},
+            {x2 + dx + dy, y2 + dy - dx},
+            {x2 + dx - dy, y2 + dy + dx},
+            {x1 - dx - dy, y1 - dy + dx}
+        };
+        AddConvex(quad, 4, color);
+    }
+
+    void Window::AddRectOutline(const SDL_Rect &rect, int thickness, const SDL_Color &color){
+        int t = std::min(thickness, std::min(rect.w, rect.h)/2 + 1);
+        SDL_Rect top = {rect.x, rect.y, rect.w, t};
+        SDL_Rect bottom = {rect.x, rect.y + rect.h - t, rect.w, t};
+        SDL_Rect left = {rect.x, rect.y + t, t, rect.h - 2*t};
+        SDL_Rect right = {rect.x + rect.w - t, rect.y + t, t, rect.h - 2*t};
+        AddRectFill(top, color);
+        AddRectFill(bottom, color);
+        AddRectFill(left, color);
+        AddRectFill(right, color);
+    }
+
+    void Window::AddRectFill(const SDL_Rect &rect, const SDL_Color &color){
+        if (rect.w <= 0 || rect.h <= 0){
+            return;
+        }
+        float x1 = static_cast<float>(rect.x);
+        float y1 = static_cast<float>(rect.y);
+        float x2 = static_cast<float>(rect.x + rect.w);
+        float y2 = static_cast<float>(rect.y + rect.h);
+        SDL_FPoint quad[4] = {{x1, y1}, {x2, y1}, {x2, y2}, {x1, y2}};
+        AddConvex(quad, 4, color);
+    }
+
+    void Window::DrawBatchRun(SDL_Renderer* r, size_t first, size_t last){
+        SDL_Texture* tex = mBatch[first].texture;
+        int texWidth = 0, texHeight = 0;
+        SDL_QueryTexture(tex, nullptr, nullptr, &texWidth, &texHeight);
+        if (texWidth <= 0 || texHeight <= 0){
+            return;
+        }
+        float invWidth = 1.0f/texWidth;
+        float invHeight = 1.0f/texHeight;
+
+        mBatchVertices.clear();
+        mBatchIndices.clear();
+        for (size_t i = first; i < last; i++){
+            const sBatchQuad &q = mBatch[i];
+
+            float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+            if (!q.fullSource){
+                u0 = q.src.x*invWidth;
+                v0 = q.src.y*invHeight;
+                u1 = (q.src.x + q.src.w)*invWidth;
+                v1 = (q.src.y + q.src.h)*invHeight;
+            }
+            if (q.flip & SDL_FLIP_HORIZONTAL){
+                std::swap(u0, u1);
+            }
+            if (q.flip & SDL_FLIP_VERTICAL){
+                std::swap(v0, v1);
+            }
+
+            // Corners relative to the rotation center, clockwise from the top left, rotated the same way SDL_RenderCopyEx does.
+            float cx = q.dst.x + q.center.x;
+            float cy = q.dst.y + q.center.y;
+            float corners[4][2] = {
+                {-q.center.x, -q.center.y},
+                {q.dst.w - q.center.x, -q.center.y},
+                {q.dst.w - q.center.x, q.dst.h - q.center.y},
+                {-q.center.x, q.dst.h - q.center.y}
+            };
+            float texCoords[4][2] = {{u0, v0}, {u1, v0}, {u1, v1}, {u0, v1}};
+            float c = 1.0f, s = 0.0f;
+            if (q.angle != 0.0){
+                double radians = q.angle*M_PI/180.0;
+                c = static_cast<float>(std::cos(radians));
+                s = static_cast<float>(std::sin(radians));
+            }
+
+            int base = static_cast<int>(mBatchVertices.size());
+            for (int k = 0; k < 4; k++){
+                SDL_Vertex v;
+                v.position.x = cx + corners[k][0]*c - corners[k][1]*s;
+                v.position.y = cy + corners[k][0]*s + corners[k][1]*c;
+                v.color = q.color;
+                v.tex_coord.x = texCoords[k][0];
+                v.tex_coord.y = texCoords[k][1];
+                mBatchVertices.push_back(v);
+            }
+            mBatchIndices.push_back(base);
+            mBatchIndices.push_back(base + 1);
+            mBatchIndices.push_back(base + 2);
+            mBatchIndices.push_back(base + 2);
+            mBatchIndices.push_back(base + 3);
+            mBatchIndices.push_back(base);
+        }
+        SDL_RenderGeometry(r, tex, &mBatchVertices[0], static_cast<int>(mBatchVertices.size()), &mBatchIndices[0], static_cast<int>(mBatchIndices.size()));
+    }
+
+
     int Window::GetNumVideoDisplays(){
         return SDL_GetNumVideoDisplays();
     }
@@ -372,7 +953,91 @@ namespace engine{
         SDL_GetDisplayMode(displayIndex, modeIndex, mode);
     }
 
+    // PRIVATE
+    void Window::ScreenSize(int *w, int *h){
+        *w = *h = 0;
+        SDL_Renderer *r = mRenderer.get();
+        if (r != 0){
+            SDL_RenderGetLogicalSize(r, w, h);
+            if (*w <= 0 || *h <= 0){
+                SDL_GetRendererOutputSize(r, w, h);
+            }
+        }
+    }
 
-} // End namespace "engine"
+    // PRIVATE
+    void Window::RecordPrimitive(int layer, CommandType type, const SDL_Rect &dst, const SDL_Color &color){
+        sCommand cmd;
+        cmd.type = type;
+        cmd.blendMode = color.a < 255 ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE;
+        cmd.texture = nullptr;
+        cmd.fullSource = true;
+        cmd.dst = dst;
+        cmd.angle = 0.0;
+        cmd.hasCenter = false;
+        cmd.flip = SDL_FLIP_NONE;
+        cmd.color = color;
+        cmd.key = CommandKey(layer, cmd.blendMode, 0, color);
+        cmd.sequence = static_cast<Uint32>(mCommands.size());
+        mCommands.push_back(cmd);
+    }
 
+    // PRIVATE
+    Uint64 Window::CommandKey(int layer, SDL_BlendMode blendMode, Uint32 textureId, const SDL_Color &color){
+        // 16 bits of layer, 4 of blend mode, 12 of texture id and 32 of color.
+        int clamped = std::max(-32768, std::min(32767, layer));
+        Uint64 blend;
+        switch (blendMode){
+        case SDL_BLENDMODE_NONE:    blend = 0; break;
+        case SDL_BLENDMODE_BLEND:   blend = 1; break;
+        case SDL_BLENDMODE_ADD:     blend = 2; break;
+        case SDL_BLENDMODE_MOD:     blend = 3; break;
+        default:                    blend = 4;
+        }
+        Uint64 rgba = (static_cast<Uint64>(color.r) << 24) | (static_cast<Uint64>(color.g) << 16) | (static_cast<Uint64>(color.b) << 8) | color.a;
+        return (static_cast<Uint64>(clamped + 32768) << 48) | (blend << 44) | (static_cast<Uint64>(textureId & 0xFFF) << 32) | rgba;
+    }
 
+    // PRIVATE
+    void Window::RedrawLayer(sLayer &layer){
+        ENGINE_PROFILE_ZONE("Window::RedrawLayer");
+        SDL_Renderer *r = mRenderer.get();
+        if (r == 0 || getRenderTarget() != nullptr){
+            // Layers draw into their own target, which can't happen while another one is in use; try next composite.
+            return;
+        }
+        // Clips pushed for the window don't apply inside the layer's own target; set them aside while it's drawn.
+        std::vector<SDL_Rect> windowClips;
+        windowClips.swap(mClipStack);
+        layer.target->setAsRenderTarget();
+        pushClipRect(layer.dirtyRegion);
+
+        // Only the dirty region is cleared, to transparent, so the rest of the layer keeps what was drawn before.
+        SDL_BlendMode blendMode;
+        SDL_GetRenderDrawBlendMode(r, &blendMode);
+        SDL_SetRenderDrawBlendMode(r, SDL_BLENDMODE_NONE);
+        SDL_Color transparent = {0, 0, 0, 0};
+        setRenderColor(&transparent);
+        SDL_RenderFillRect(r, &layer.dirtyRegion);
+        SDL_SetRenderDrawBlendMode(r, blendMode);
+
+        if (layer.painter){
+            layer.painter(layer.dirtyRegion);
+        }
+        popClipRect();
+        layer.target->clearRenderTarget();
+        mClipStack.swap(windowClips);
+        setClipRect(mClipStack.empty() ? nullptr : &mClipStack.back());
+        layer.dirty = false;
+    }
+
+    int SDLCALL Window::RenderResetWatch(void* window, SDL_Event* event){
+        // Watches can run on whichever thread pushed the event, but SDL only sends these while rendering, on the render thread.
+        if (event->type == SDL_RENDER_TARGETS_RESET || event->type == SDL_RENDER_DEVICE_RESET){
+            static_cast<Window*>(window)->markAllLayersDirty();
+        }
+        return 0;
+    }
+
+
+} // End namespace "engine"
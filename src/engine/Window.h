@@ -28,6 +28,9 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <unordered_map>
+#include <boost/function.hpp>
 
 #include <SDL2/SDL.h>
 
@@ -40,10 +43,13 @@ typedef Handler<SDL_Window> SDLWindowHnd;
 typedef Handler<SDL_Renderer> SDLRendererHnd;
 
 
-class Window
+class Texture;
+
+class Window : public std::enable_shared_from_this<Window>
 {
     public:
         Window(std::string title, int x, int y, int w, int h, Uint32 flags=0, Uint32 rflags=SDL_RENDERER_ACCELERATED);
+        ~Window();
 
         /* -- Basic Drawing Operations -- */
         void setPenColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a=255);
@@ -65,11 +71,32 @@ class Window
         void setPenThickness(Uint16 thickness);
         int getPenThickness();
 
+        /*
+        * Lines and shapes are tessellated into triangles and queued, with their colors, on a shape batch that is drawn
+        * with one SDL_RenderGeometry call when anything else is drawn (or at flushBatch), so thousands of primitives cost
+        * a few driver calls.
+        */
+
+        /**
+        * Lines are drawn in the pen color, pen thickness wide (at least one pixel), with square ends.
+        */
         void drawLine(int x1, int y1, int x2, int y2);
         void drawLines(const SDL_Point* points, int count);
+
+        /**
+        * Shapes are filled with the bucket color, then outlined inside their edge in the pen color, pen thickness wide
+        * (no outline at a thickness of 0). Hollow shapes are only outlined.
+        */
         void drawRect(int x, int y, int w, int h, bool hollow=false);
         void drawRect(const SDL_Rect* rect, bool hollow=false);
         void drawRects(const SDL_Rect* rects, int count, bool hollow=false);
+        void drawCircle(int x, int y, int radius, bool hollow=false);
+
+        /**
+        * Draws the closed polygon through the given points. Only convex polygons are filled correctly.
+        */
+        void drawPolygon(const SDL_Point* points, int count, bool hollow=false);
+
         void drawPoint(int x, int y);
         void drawPoint(const SDL_Point* point);
         void drawPoints(const SDL_Point* points, int count);
@@ -82,6 +109,104 @@ class Window
         void setRenderTarget(SDL_Texture *target);
         SDL_Texture* getRenderTarget();
 
+        /**
+        * Limits drawing to the given rectangle, or lifts the limit if it's nullptr. Flushes the sprite batch first, so
+        * only what's drawn after the call is clipped. This replaces whatever clip is in effect; code that may be called
+        * while something else is clipping (a layer painter, say) should use pushClipRect and popClipRect instead.
+        */
+        void setClipRect(const SDL_Rect* rect);
+
+        /**
+        * Limits drawing to the given rectangle intersected with the clip already pushed, if any, until the matching
+        * popClipRect, which puts the previous clip back.
+        */
+        void pushClipRect(const SDL_Rect &rect);
+        void popClipRect();
+
+        /* -- Sprite Batching -- */
+        /**
+        * Queues a quad to be drawn at the next flushBatch. Arguments match render(), plus an optional color modulation.
+        * On flush, queued quads are grouped by blend mode and texture and drawn with as few driver calls as possible
+        * (one SDL_RenderGeometry call per texture). Quads sharing a texture keep the order they were
+        * queued in, but quads of different textures may be reordered, so flush between layers that overlap.
+        * The batch is flushed before any immediate drawing, queued shape, render target change or present, so those keep
+        * their order.
+        * NOTE: The texture must stay alive until the batch is flushed.
+        */
+        void batch(SDL_Texture *tex, const SDL_Rect* src, const SDL_Rect* dst, const double& angle=0.0, const SDL_Point* center=nullptr, const SDL_RendererFlip& flip=SDL_FLIP_NONE, const SDL_Color* color=nullptr);
+        void flushBatch();
+
+        /* -- Layers -- */
+        /** \typedef boost::function<void (const SDL_Rect &dirty)>
+        * Draws a layer's content, in layer coordinates. Given the region being redrawn, so it may skip what lies outside.
+        */
+        typedef boost::function<void (const SDL_Rect &dirty)> LayerPainter;
+
+        /**
+        * Adds a layer covering the given area of the window (the whole logical size if nullptr), replacing any layer of
+        * the same name. Layers keep their content in a render target texture; the painter is only called when some of the
+        * layer is dirty, with the target clipped to, and cleared in, the dirty region. New layers start dirty.
+        * Lower depths are composited first.
+        */
+        void addLayer(const std::string &name, int depth, LayerPainter painter, const SDL_Rect* area=nullptr);
+        void removeLayer(const std::string &name);
+        bool hasLayer(const std::string &name);
+
+        /**
+        * Marks the given region of the layer, in layer coordinates, to be redrawn (all of it if nullptr). Regions marked
+        * before the next composite are merged into their bounding rectangle.
+        */
+        void markLayerDirty(const std::string &name, const SDL_Rect* region=nullptr);
+
+        /**
+        * Marks every layer to be redrawn in full. Done automatically when the renderer reports that render target
+        * contents were lost (SDL_RENDER_TARGETS_RESET or SDL_RENDER_DEVICE_RESET).
+        */
+        void markAllLayersDirty();
+
+        /**
+        * Redraws the dirty regions of the layers, then copies every layer onto the current target in depth order.
+        * Layers entirely outside the window are skipped, and stay dirty until they're back in view.
+        * Call once a frame, where the layers belong in the frame's drawing order.
+        */
+        void compositeLayers();
+
+        /* -- Camera -- */
+        /**
+        * Sets the world position shown at the window's top left corner. The viewport is the world area the window shows,
+        * from there and the size of the logical renderer (the output, if no logical size is set).
+        * Drawing stays in window coordinates; render passes use the viewport to pick what to draw (see SpatialGrid) and
+        * worldToScreen to place it.
+        */
+        void setCamera(int x, int y);
+        void getCamera(int *x, int *y);
+        void getViewport(SDL_Rect *view);
+        bool isVisible(const SDL_Rect &world);
+        void worldToScreen(const SDL_Rect &world, SDL_Rect &screen);
+
+        /* -- Command List -- */
+        /**
+        * Records a draw command, to be drawn at the next submitCommands (present submits any left over).
+        * Commands are sorted by layer (lower first), then blend mode, then texture, then color, so a frame's state changes
+        * happen once per distinct state rather than whenever callers interleave draws. Commands with equal keys keep the
+        * order they were recorded in. Within a layer, commands are grouped by blend mode, untextured ones first in each
+        * group; draws that must overlap in a given order belong on different layers.
+        * Untextured commands blend if their color isn't opaque. Textured ones use the texture's blend mode, and the color,
+        * if given, modulates the texture.
+        * NOTE: Textures must stay alive until the commands are submitted.
+        */
+        void recordTexture(int layer, SDL_Texture *tex, const SDL_Rect* src, const SDL_Rect* dst, const SDL_Color* color=nullptr, const double& angle=0.0, const SDL_Point* center=nullptr, const SDL_RendererFlip& flip=SDL_FLIP_NONE);
+        void recordFillRect(int layer, const SDL_Rect &rect, const SDL_Color &color);
+        void recordRect(int layer, const SDL_Rect &rect, const SDL_Color &color);
+        void recordLine(int layer, int x1, int y1, int x2, int y2, const SDL_Color &color);
+        void recordPoint(int layer, int x, int y, const SDL_Color &color);
+
+        /**
+        * Sorts and draws the recorded commands, then clears them.
+        */
+        void submitCommands();
+        size_t commandCount();
+
         /* -- States -- */
         void setLogicalRendererSize(int w, int h);
         void setFullscreen();
@@ -121,9 +246,99 @@ class Window
         SDL_Color mBucketColor;
         SDL_Color mPenColor;
 
-        /** Simple color setting helper method.*/
-        void setRenderColor(SDL_Color *c);
+        /**
+        * Simple color setting helper method. The renderer's draw color is tracked, so setting the color it already has
+        * costs nothing. Code changing it directly through getSDLRenderer should call forgetRenderColor afterwards.
+        */
+        void setRenderColor(const SDL_Color *c);
+        void forgetRenderColor();
     private:
+        struct sBatchQuad{
+            SDL_Texture* texture;
+            SDL_BlendMode blendMode;
+            SDL_Rect src;
+            bool fullSource;
+            SDL_Rect dst;
+            double angle;
+            SDL_FPoint center;
+            SDL_RendererFlip flip;
+            SDL_Color color;
+        };
+        typedef std::vector<sBatchQuad> BatchQuadList;
+        BatchQuadList mBatch;
+
+        // Kept between flushes so a flush doesn't allocate once they've grown to fit.
+        std::vector<SDL_Vertex> mBatchVertices;
+        std::vector<int> mBatchIndices;
+
+        void DrawBatchRun(SDL_Renderer* r, size_t first, size_t last);
+
+        // Untextured triangles of queued lines and shapes, colors included; see drawLine.
+        std::vector<SDL_Vertex> mShapeVertices;
+        std::vector<int> mShapeIndices;
+
+        void FlushShapes();
+
+        /** Queues a convex polygon on the shape batch. */
+        void AddConvex(const SDL_FPoint* points, int count, const SDL_Color &color);
+        void AddSegment(float x1, float y1, float x2, float y2, float thickness, const SDL_Color &color);
+        void AddRectOutline(const SDL_Rect &rect, int thickness, const SDL_Color &color);
+        void AddRectFill(const SDL_Rect &rect, const SDL_Color &color);
+
+        struct sLayer{
+            std::string name;
+            int depth;
+            LayerPainter painter;
+            SDL_Rect area;
+            std::shared_ptr<Texture> target;
+            bool dirty;
+            SDL_Rect dirtyRegion;
+        };
+        // Kept sorted by depth.
+        std::vector<sLayer> mLayers;
+
+        void RedrawLayer(sLayer &layer);
+
+        /** SDL event watch marking the layers dirty when render targets lose their contents. */
+        static int SDLCALL RenderResetWatch(void* window, SDL_Event* event);
+
+        // Clips pushed with pushClipRect, each already intersected with the one below it.
+        std::vector<SDL_Rect> mClipStack;
+
+        int mCameraX;
+        int mCameraY;
+
+        /** The logical renderer size, or the output size if no logical size is set. */
+        void ScreenSize(int *w, int *h);
+
+        SDL_Color mRenderColor;
+        bool mRenderColorKnown;
+
+        enum CommandType {Command_Texture, Command_FillRect, Command_Rect, Command_Line, Command_Point};
+        struct sCommand{
+            Uint64 key;         /**< Layer, blend mode, texture and color, most significant first. */
+            Uint32 sequence;    /**< Order recorded in, breaking ties between equal keys. */
+            CommandType type;
+            SDL_BlendMode blendMode;
+            SDL_Texture* texture;
+            SDL_Rect src;
+            bool fullSource;
+            SDL_Rect dst;       /**< Destination, rectangle, line (x, y to w, h) or point (x, y). */
+            double angle;
+            SDL_Point center;
+            bool hasCenter;
+            SDL_RendererFlip flip;
+            SDL_Color color;
+        };
+        std::vector<sCommand> mCommands;
+        // Small per frame ids for textures, so a texture fits in a sort key. Id 0 is for untextured commands.
+        std::unordered_map<SDL_Texture*, Uint32> mCommandTextureIds;
+        // Kept between submits so merging runs of rectangles and points doesn't allocate once they've grown to fit.
+        std::vector<SDL_Rect> mCommandRects;
+        std::vector<SDL_Point> mCommandPoints;
+
+        void RecordPrimitive(int layer, CommandType type, const SDL_Rect &dst, const SDL_Color &color);
+        Uint64 CommandKey(int layer, SDL_BlendMode blendMode, Uint32 textureId, const SDL_Color &color);
 };
 typedef std::shared_ptr<Window> WindowPtr;
 typedef Handler<Window> WindowHnd;
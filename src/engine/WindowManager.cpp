@@ -43,7 +43,7 @@ WindowManager* WindowManager::getInstance(){
 WindowHnd WindowManager::createWindow(std::string wname, std::string title, int x, int y, int w, int h, Uint32 wflags, Uint32 rflags){
     if (!this->has(wname)){
         WindowPtr win(new Window(title, x, y, w, h, wflags, rflags));
-        mResources.insert(std::pair<std::string, WindowPtr>(wname, win));
+        store(wname, win, "");
         return WindowHnd(win);
     }
     throw std::runtime_error(std::string("Cannot create Window named \"") + wname + std::string("\". Window already exists."));
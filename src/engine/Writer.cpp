@@ -24,6 +24,7 @@
 
 
 #include "Writer.h"
+#include "Profiler.h"
 
 namespace engine{
 
@@ -40,7 +41,7 @@ namespace engine{
         return WriterHnd(mInstance);
     }
 
-    Writer::Writer()
+    Writer::Writer() : mTextCacheBytes(0), mTextCacheBudget(DEFAULT_TEXT_CACHE_BUDGET)
     {
         if (TTF_Init() != 0){
             throw std::runtime_error("Failed to initilize Truetype Font writer.");
@@ -49,19 +50,35 @@ namespace engine{
 
     Writer::~Writer()
     {
-        while (!mFonts.empty()){
-            TTF_CloseFont(mFonts.begin()->second);
-            mFonts.erase(mFonts.begin());
+        clearTextCache();
+        for (FontMapIter item = mFonts.begin(); item != mFonts.end(); item++){
+            // Atlases go first; they refer to the font.
+            item->second.atlases.clear();
+            TTF_CloseFont(item->second.font);
         }
+        mFonts.clear();
+        mFontFiles.clear();
     }
 
     void Writer::defineFont(std::string fontName, std::string fontSrc, int fontSize){
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
         if (getFontPtr(fontName) == nullptr){
-            TTF_Font *font = TTF_OpenFont(fontSrc.c_str(), fontSize);
+            // SDL_ttf reads from the font's data for as long as the font is open, so the data is kept, once per source.
+            std::map<std::string, FileData>::iterator fontFile = mFontFiles.find(fontSrc);
+            if (fontFile == mFontFiles.end()){
+                FileData file;
+                if (!VirtualFileSystem::getInstance()->read(fontSrc, file)){
+                    throw std::runtime_error(std::string("Failed to open font \"") + fontSrc + std::string("\"."));
+                }
+                fontFile = mFontFiles.insert(std::pair<std::string, FileData>(fontSrc, file)).first;
+            }
+            TTF_Font *font = TTF_OpenFontRW(fontFile->second.rwops(), 1, fontSize);
             if (font == nullptr){
                 throw std::runtime_error(std::string("Failed to open font \"") + fontSrc + std::string("\"."));
             }
-            mFonts.push_back(FontPair(fontName, font));
+            sFont entry;
+            entry.font = font;
+            mFonts[fontName] = entry;
         }
     }
 
@@ -70,6 +87,7 @@ namespace engine{
     }
 
     int Writer::getFontPixelHeight(std::string fontName){
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
         TTF_Font* font = getFontPtr(fontName);
         if (font != nullptr){
             return TTF_FontHeight(font);
@@ -78,10 +96,36 @@ namespace engine{
     }
 
     void Writer::getFontStringTextSize(std::string fontName, std::string str, int *w, int *h){
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
         TTF_Font* font = getFontPtr(fontName);
         if (font != nullptr){
-            TTF_SizeText(font, str.c_str(), w, h);
+            TTF_SizeUTF8(font, str.c_str(), w, h);
+        }
+    }
+
+    int Writer::getFontStringWidth(std::string fontName, std::string str){
+        std::string key;
+        key.reserve(fontName.size() + 1 + str.size());
+        key.append(fontName);
+        key.push_back('\0');
+        key.append(str);
+
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
+        std::unordered_map<std::string, int>::iterator item = mStringWidths.find(key);
+        if (item != mStringWidths.end()){
+            return item->second;
+        }
+        TTF_Font* font = getFontPtr(fontName);
+        if (font == nullptr){
+            return 0;
         }
+        int w = 0;
+        TTF_SizeUTF8(font, str.c_str(), &w, nullptr);
+        if (mStringWidths.size() >= MAX_CACHED_WIDTHS){
+            mStringWidths.clear();
+        }
+        mStringWidths[key] = w;
+        return w;
     }
 
     void Writer::setPenColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a){
@@ -113,14 +157,21 @@ namespace engine{
     }
 
     SDL_Surface* Writer::textToSurface(std::string fontName, std::string message){
+        return textToSurface(fontName, message, mPen);
+    }
+
+    SDL_Surface* Writer::textToSurface(std::string fontName, std::string message, const SDL_Color &color){
+        ENGINE_PROFILE_ZONE("Writer::textToSurface");
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
         TTF_Font* font = getFontPtr(fontName);
         if (font != nullptr){
-            return TTF_RenderText_Blended(font, message.c_str(), mPen);
+            return TTF_RenderUTF8_Blended(font, message.c_str(), color);
         }
         return nullptr;
     }
 
     SDL_Texture* Writer::textToTexture(WindowHnd win, std::string fontName, std::string message){
+        ENGINE_PROFILE_ZONE("Writer::textToTexture");
         if (win.IsValid()){
             SDL_Surface* surf = textToSurface(fontName, message);
             if (surf != nullptr){
@@ -133,35 +184,114 @@ namespace engine{
     }
 
     void Writer::presentToWindow(WindowHnd win, std::string fontName, std::string message, int x, int y){
-        SDL_Texture* t = textToTexture(win, fontName, message);
-        // Since textToTexture checks the validity of the given WindowHnd object itself, we don't need to
-        // check it's validity here... we only need to check that we have a texture.
-        if (t != nullptr){
-            SDL_Rect src;
-            SDL_Rect pos;
-            src.x = 0;
-            src.y = 0;
-            SDL_QueryTexture(t, NULL, NULL, &src.w, &src.h);
-            pos.x = x;
-            pos.y = y;
-            pos.w = src.w;
-            pos.h = src.h;
-            win->render(t, nullptr, &pos);
-            SDL_DestroyTexture(t);
+        ENGINE_PROFILE_ZONE("Writer::presentToWindow");
+        if (!win.IsValid()){
+            return;
+        }
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
+        FontMapIter item = mFonts.find(fontName);
+        if (item != mFonts.end()){
+            GlyphAtlasPtr &atlas = item->second.atlases[win.get()];
+            if (atlas.get() == 0){
+                atlas = GlyphAtlasPtr(new GlyphAtlas(item->second.font, win));
+            }
+            atlas->draw(message, x, y, mPen);
+        }
+    }
+
+    TexturePtr Writer::cachedText(WindowHnd win, std::string fontName, std::string message){
+        return cachedText(win, fontName, message, mPen);
+    }
+
+    TexturePtr Writer::cachedText(WindowHnd win, std::string fontName, std::string message, const SDL_Color &color){
+        ENGINE_PROFILE_ZONE("Writer::cachedText");
+        if (!win.IsValid()){
+            return TexturePtr();
+        }
+
+        // Window, color and font name are fixed width or NUL terminated, so no two requests share a key.
+        std::string key;
+        key.reserve(sizeof(Window*) + 4 + fontName.size() + 1 + message.size());
+        Window* w = win.get();
+        key.append(reinterpret_cast<const char*>(&w), sizeof(Window*));
+        key.push_back(static_cast<char>(color.r));
+        key.push_back(static_cast<char>(color.g));
+        key.push_back(static_cast<char>(color.b));
+        key.push_back(static_cast<char>(color.a));
+        key.append(fontName);
+        key.push_back('\0');
+        key.append(message);
+
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
+        TextCacheIter item = mTextCache.find(key);
+        if (item != mTextCache.end()){
+            mTextCacheUse.splice(mTextCacheUse.begin(), mTextCacheUse, item->second.use);
+            return item->second.texture;
+        }
+
+        SDL_Surface* surf = textToSurface(fontName, message, color);
+        if (surf == nullptr){
+            return TexturePtr();
+        }
+        SDL_SurfacePtr surface(surf, SDL_FreeSurface);
+        TexturePtr tex;
+        try{
+            tex = TexturePtr(new Texture(surface, win));
+        } catch (std::runtime_error e){
+            throw e;
         }
+
+        sCachedText entry;
+        entry.texture = tex;
+        entry.bytes = tex->estimatedBytes() + static_cast<size_t>(surf->pitch)*surf->h;
+        mTextCacheUse.push_front(key);
+        entry.use = mTextCacheUse.begin();
+        mTextCache[key] = entry;
+        mTextCacheBytes += entry.bytes;
+        TrimTextCache();
+        return tex;
+    }
+
+    void Writer::setTextCacheBudget(size_t bytes){
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
+        mTextCacheBudget = bytes;
+        TrimTextCache();
+    }
+
+    size_t Writer::getTextCacheBudget(){
+        return mTextCacheBudget;
+    }
+
+    size_t Writer::textCacheBytes(){
+        return mTextCacheBytes;
+    }
+
+    void Writer::clearTextCache(){
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
+        mTextCache.clear();
+        mTextCacheUse.clear();
+        mTextCacheBytes = 0;
     }
 
 
     TTF_Font* Writer::getFontPtr(std::string fontName){
-        if (!mFonts.empty()){
-            for (FontListIter item = mFonts.begin(); item != mFonts.end(); item++){
-                if (item->first == fontName){
-                    return item->second;
-                }
-            }
+        boost::recursive_mutex::scoped_lock lock(mFontProtection);
+        FontMapIter item = mFonts.find(fontName);
+        if (item != mFonts.end()){
+            return item->second.font;
         }
         return nullptr;
     }
 
+    void Writer::TrimTextCache(){
+        // The most recent entry always stays, so text larger than the whole budget is still returned.
+        while (mTextCacheBytes > mTextCacheBudget && mTextCacheUse.size() > 1){
+            TextCacheIter item = mTextCache.find(mTextCacheUse.back());
+            mTextCacheBytes -= item->second.bytes;
+            mTextCache.erase(item);
+            mTextCacheUse.pop_back();
+        }
+    }
+
 
 }
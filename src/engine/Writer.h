@@ -27,12 +27,20 @@
 */
 
 #include <vector>
+#include <map>
+#include <list>
+#include <unordered_map>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
+#include <boost/thread/recursive_mutex.hpp>
+
 #include "Handler.h"
 #include "Window.h"
+#include "VirtualFileSystem.h"
+#include "GlyphAtlas.h"
+#include "Texture.h"
 
 
 namespace engine{
@@ -41,6 +49,9 @@ namespace engine{
     typedef std::shared_ptr<Writer> WriterPtr;
     typedef Handler<Writer> WriterHnd;
 
+    /** \class
+    * \brief Defines fonts and draws or renders text with them. All strings given to the Writer are UTF-8.
+    */
     class Writer
     {
         public:
@@ -54,6 +65,12 @@ namespace engine{
             int getFontPixelHeight(std::string fontName);
             void getFontStringTextSize(std::string fontName, std::string str, int *w, int *h);
 
+            /**
+            * Returns the width, in pixels, of the given string in the requested font (0 if the font isn't defined).
+            * Widths are cached per font and string, so measuring the same words again is a lookup.
+            */
+            int getFontStringWidth(std::string fontName, std::string str);
+
             void setPenColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a=255);
             void setPenColor(const SDL_Color *c);
             void getPenColor(Uint8 *r, Uint8 *g, Uint8 *b, Uint8 *a);
@@ -65,6 +82,12 @@ namespace engine{
             */
             SDL_Surface* textToSurface(std::string fontName, std::string message);
 
+            /**
+            * Same as above, but rendered in the given color instead of the pen color.
+            * As this neither reads nor changes the pen, it is the one to use from worker threads (see IState::prepare).
+            */
+            SDL_Surface* textToSurface(std::string fontName, std::string message, const SDL_Color &color);
+
             /**
             * Generates an SDL_Texture object with the given message rendered using the requested font, and returns a pointer to the SDL_Texture object.
             * NOTE: The Writer class does not take ownership of the generated SDL_Texture. The SDL_Texture will need to be freed manually.
@@ -73,24 +96,77 @@ namespace engine{
 
             /**
             * Renders out the given message to the given window using the given font at the given x,y coordinates.
-            * Once the text has been pushed to the window, all generated surfaces or textures are destroyed.
+            * Glyphs are rasterized once per font and window into a glyph atlas, and the message is queued on the window's
+            * sprite batch (see Window::batch), so repeated text costs no rasterizing or texture uploads.
             */
             void presentToWindow(WindowHnd win, std::string fontName, std::string message, int x, int y);
 
+            /**
+            * Returns a texture of the given message rendered with the requested font in the pen color, or an empty pointer if
+            * the font isn't defined or the message can't be rendered.
+            * Textures are cached by window, font, color and message, so asking again for the same text costs a lookup rather
+            * than a render and an upload. The least recently asked for textures are dropped from the cache once it holds more
+            * than the text cache budget; callers still holding one keep it alive. Must be called on the thread that renders.
+            */
+            TexturePtr cachedText(WindowHnd win, std::string fontName, std::string message);
+
+            /**
+            * Same as above, but rendered in the given color instead of the pen color.
+            */
+            TexturePtr cachedText(WindowHnd win, std::string fontName, std::string message, const SDL_Color &color);
+
+            /**
+            * Sets the most memory, in bytes, the cached text textures (and the surfaces kept to recreate them) may use.
+            */
+            void setTextCacheBudget(size_t bytes);
+            size_t getTextCacheBudget();
+            size_t textCacheBytes();
+            void clearTextCache();
+
             static WriterHnd getHandle();
 
         private:
-            typedef std::pair<std::string, TTF_Font*> FontPair;
-            typedef std::vector<FontPair> FontList;
-            typedef std::vector<FontPair>::iterator FontListIter;
-            FontList mFonts;
+            struct sFont{
+                TTF_Font* font;
+                // Glyph atlases hold textures, so there is one per window the font has been drawn to.
+                std::map<Window*, GlyphAtlasPtr> atlases;
+            };
+            typedef std::unordered_map<std::string, sFont> FontMap;
+            typedef FontMap::iterator FontMapIter;
+            FontMap mFonts;
+            std::map<std::string, FileData> mFontFiles;
+
+            struct sCachedText{
+                TexturePtr texture;
+                size_t bytes;
+                std::list<std::string>::iterator use;
+            };
+            typedef std::unordered_map<std::string, sCachedText> TextCache;
+            typedef TextCache::iterator TextCacheIter;
+            TextCache mTextCache;
+            // Cache keys, most recently used first.
+            std::list<std::string> mTextCacheUse;
+            size_t mTextCacheBytes;
+            size_t mTextCacheBudget;
+
+            static const size_t DEFAULT_TEXT_CACHE_BUDGET = 4*1024*1024;
+
+            // String widths by font name and string. Cleared whole when it reaches its limit; it refills with what's in use.
+            std::unordered_map<std::string, int> mStringWidths;
+            static const size_t MAX_CACHED_WIDTHS = 8192;
 
             SDL_Color mPen;
 
+            // SDL_ttf fonts are not thread-safe, so every use of a font (and of the font list) happens under this lock.
+            boost::recursive_mutex mFontProtection;
+
             static WriterPtr mInstance;
             Writer();
 
             TTF_Font* getFontPtr(std::string fontName);
+
+            /** Drops the least recently used cached text until the cache fits its budget. */
+            void TrimTextCache();
     };
 
 }
@@ -24,8 +24,8 @@
 
 
 #include <sstream>
-#include <fstream>
 #include "JSonValue.h"
+#include "../VirtualFileSystem.h"
 
 
 namespace engine{ namespace json {
@@ -391,15 +391,12 @@ namespace engine{ namespace json {
     }
 
     JSonValue JSonValue::ParseFromFile(const std::string &src){
-        std::ifstream f(src.c_str());
-        if (!f)
+        FileData file;
+        if (!VirtualFileSystem::getInstance()->read(src, file))
             throw std::runtime_error("File not found or cannot be read.");
 
-        std::stringstream ss;
-        ss << f.rdbuf();
-
         try{
-            return JSonValue::ParseFromString(ss.str());
+            return JSonValue::ParseFromString(std::string(file.data, file.size));
         } catch (std::runtime_error e){throw e;}
     }
 
@@ -73,9 +73,39 @@ int main ( int argc, char** argv )
     /*SDLApp* app = new SDLApp();
     app->run();*/
 
+    // --record <file> journals this session's input. --replay <file> plays a journal back headless, as fast as possible.
+    std::string recordPath;
+    std::string replayPath;
+    for (int i = 1; i < argc-1; i++){
+        if (std::string(argv[i]) == "--record"){
+            recordPath = argv[++i];
+        } else if (std::string(argv[i]) == "--replay"){
+            replayPath = argv[++i];
+        }
+    }
+    engine::EventJournalPtr journal = engine::EventJournal::getInstance();
+    if (replayPath != ""){
+        engine::EventJournal::UseHeadlessVideo();
+    }
+
     Application *app = new Application();
     new MainMenu(app->getGameStateManager()); // I shouldn't need to store this in a variable, as the MainMenu constructor stores the object into the given GameStateManager.
+
+    if (replayPath != ""){
+        journal->startReplay(replayPath);
+    } else if (recordPath != ""){
+        journal->startRecording(recordPath);
+    }
+
+    Uint64 runStart = SDL_GetPerformanceCounter();
     app->run();
+    double runMS = (SDL_GetPerformanceCounter() - runStart) * 1000.0 / SDL_GetPerformanceFrequency();
+
+    if (journal->replaying()){
+        unsigned int frames = journal->frame() > 0 ? journal->frame()-1 : 0;
+        printf("Replayed %u frames in %.2fms (%.3fms/frame), %u divergence(s)\n", frames, runMS, frames > 0 ? runMS/frames : 0.0, journal->divergences());
+    }
+    journal->stop();
 
     // all is well ;)
     printf("Exited cleanly\n");
@@ -0,0 +1,72 @@
+/*
+* The MIT License (MIT)
+*
+* Copyright (c) 2014 Bryan Miller
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+/*
+* Packs asset files into an archive the engine's VirtualFileSystem can mount.
+*
+* Usage: packassets [--compress] <archive> <file>...
+* Each file is stored under the path it was given as, so run it from the directory the game runs from, e.g.
+*   packassets --compress assets.sfpk $(find assets -type f)
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "engine/Archive.h"
+
+
+int main(int argc, char** argv)
+{
+    bool compress = false;
+    int first = 1;
+    if (argc > 1 && std::strcmp(argv[1], "--compress") == 0){
+        compress = true;
+        first = 2;
+    }
+    if (argc - first < 2){
+        printf("Usage: %s [--compress] <archive> <file>...\n", argv[0]);
+        return 1;
+    }
+
+    std::string archivePath = argv[first];
+    engine::Archive::PackList items;
+    for (int i = first+1; i < argc; i++){
+        items.push_back(engine::Archive::PackItem(argv[i], argv[i]));
+    }
+
+    try{
+        engine::Archive::Pack(archivePath, items, compress);
+        // Read it back, so a bad archive is caught here rather than by the game.
+        engine::Archive archive(archivePath);
+        std::vector<std::string> paths;
+        archive.getPaths(paths);
+        printf("Packed %u file(s) into \"%s\"\n", static_cast<unsigned int>(paths.size()), archivePath.c_str());
+    } catch (std::runtime_error e){
+        printf("%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}